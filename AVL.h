@@ -3,6 +3,17 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "FrozenSet.h"
+#include "NodeArena.h"
+#include "ThreadPool.h"
 
 template<typename T>
 class NodeALV {
@@ -15,25 +26,213 @@ public:
     NodeALV(T k) : key(k), left(nullptr), right(nullptr), height(1) {}
 };
 
-template<typename T>
+template<typename T, typename Alloc = NodeArena<NodeALV<T>>>
 class AVL {
 public:
+    // An AVL tree of height 64 needs more than 2^44 nodes, so no tree that fits
+    // in memory can be deeper than this.
+    static constexpr int MAX_HEIGHT = 64;
+
+    // Batch runs this short are cheaper to insert one by one into the subtree
+    // they landed in than to split and join around.
+    static constexpr long BATCH_CUTOFF = 8;
+
+    // Set operations only fork when both subtrees are at least this tall
+    // (a few hundred nodes); below that a task costs more than it saves.
+    static constexpr int PARALLEL_CUTOFF_HEIGHT = 12;
+
+    // Lookups search_many keeps in flight by default, and at most.
+    static constexpr std::size_t SEARCH_GROUP = 16;
+    static constexpr std::size_t MAX_SEARCH_GROUP = 64;
+
     NodeALV<T>* root;
 
+    // In-order bidirectional iterator. It keeps the path from the root in a
+    // fixed MAX_HEIGHT array, so stepping is amortized O(1) and never
+    // allocates. Any insert or delete invalidates it.
+    class iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() : root(nullptr), depth(0) {}
+
+        reference operator*() const {
+            return path[depth - 1]->key;
+        }
+
+        pointer operator->() const {
+            return &path[depth - 1]->key;
+        }
+
+        NodeALV<T>* node() const {
+            return depth > 0 ? path[depth - 1] : nullptr;
+        }
+
+        iterator& operator++() {
+            NodeALV<T>* current = path[depth - 1];
+            if (current->right) {
+                pushLeftSpine(current->right);
+            } else {
+                NodeALV<T>* child;
+                do {
+                    child = path[--depth];
+                } while (depth > 0 && path[depth - 1]->right == child);
+            }
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        iterator& operator--() {
+            if (depth == 0) {
+                pushRightSpine(root);
+            } else if (path[depth - 1]->left) {
+                pushRightSpine(path[depth - 1]->left);
+            } else {
+                NodeALV<T>* child;
+                do {
+                    child = path[--depth];
+                } while (depth > 0 && path[depth - 1]->left == child);
+            }
+            return *this;
+        }
+
+        iterator operator--(int) {
+            iterator previous = *this;
+            --*this;
+            return previous;
+        }
+
+        bool operator==(const iterator& other) const {
+            return node() == other.node();
+        }
+
+        bool operator!=(const iterator& other) const {
+            return node() != other.node();
+        }
+
+    private:
+        friend class AVL;
+
+        explicit iterator(NodeALV<T>* root) : root(root), depth(0) {}
+
+        void pushLeftSpine(NodeALV<T>* node) {
+            for (; node; node = node->left) {
+                path[depth++] = node;
+            }
+        }
+
+        void pushRightSpine(NodeALV<T>* node) {
+            for (; node; node = node->right) {
+                path[depth++] = node;
+            }
+        }
+
+        NodeALV<T>* root;
+        int depth;
+        NodeALV<T>* path[MAX_HEIGHT];
+    };
+
+    using const_iterator = iterator;
+
     AVL() : root(nullptr) {}
 
+    AVL(const AVL&) = delete;
+    AVL& operator=(const AVL&) = delete;
+
+    template<typename ForwardIt>
+    AVL(ForwardIt first, ForwardIt last) : root(nullptr) {
+        build_from_sorted(first, last);
+    }
+
     ~AVL() {
-        destroyTree(root);
+        clear();
+    }
+
+    void clear() {
+        // With a slab arena and nothing to destruct, dropping the chunks frees every node.
+        if constexpr (Alloc::releasesInBulk && std::is_trivially_destructible_v<T>) {
+            alloc.release();
+        } else {
+            destroyTree(root);
+        }
+        root = nullptr;
+    }
+
+    // Replaces the contents with the keys of an ascending range in O(n).
+    // Duplicates are skipped; nodes are stored in key order in one contiguous
+    // block when the allocator supports it, and linked into a perfectly
+    // balanced tree.
+    template<typename ForwardIt>
+    void build_from_sorted(ForwardIt first, ForwardIt last) {
+        clear();
+        std::size_t capacity = std::distance(first, last);
+        if (capacity == 0) {
+            return;
+        }
+
+        std::size_t count = 0;
+        if constexpr (Alloc::releasesInBulk) {
+            NodeALV<T>* block = alloc.allocateBlock(capacity);
+            for (; first != last; ++first) {
+                if (count == 0 || block[count - 1].key < *first) {
+                    new (&block[count++]) NodeALV<T>(*first);
+                }
+            }
+            for (std::size_t i = count; i < capacity; ++i) {
+                alloc.deallocate(&block[i]);
+            }
+            root = linkBalanced([block](std::size_t i) { return &block[i]; }, 0, count);
+        } else {
+            std::vector<NodeALV<T>*> nodes;
+            nodes.reserve(capacity);
+            for (; first != last; ++first) {
+                if (nodes.empty() || nodes.back()->key < *first) {
+                    nodes.push_back(createNode(*first));
+                }
+            }
+            root = linkBalanced([&nodes](std::size_t i) { return nodes[i]; }, 0, nodes.size());
+        }
+    }
+
+    template<typename NodeAt>
+    NodeALV<T>* linkBalanced(const NodeAt& nodeAt, std::size_t lo, std::size_t hi) {
+        if (lo == hi) {
+            return nullptr;
+        }
+        std::size_t mid = lo + (hi - lo) / 2;
+        NodeALV<T>* node = nodeAt(mid);
+        node->left = linkBalanced(nodeAt, lo, mid);
+        node->right = linkBalanced(nodeAt, mid + 1, hi);
+        node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
+        return node;
     }
 
     void destroyTree(NodeALV<T>* node) {
         if (node != nullptr) {
             destroyTree(node->left);
             destroyTree(node->right);
-            delete node;
+            destroyNode(node);
         }
     }
 
+    NodeALV<T>* createNode(T key) {
+        return new (alloc.allocate()) NodeALV<T>(key);
+    }
+
+    void destroyNode(NodeALV<T>* node) {
+        node->~NodeALV<T>();
+        alloc.deallocate(node);
+    }
+
     int getHeight(NodeALV<T>* node) {
         return node ? node->height : 0;
     }
@@ -70,7 +269,7 @@ public:
 
     NodeALV<T>* insert(NodeALV<T>* node, T key) {
         if (!node) {
-            return new NodeALV<T>(key);
+            return createNode(key);
         }
 
         if (key < node->key) {
@@ -106,6 +305,249 @@ public:
         return node; // return node when balanceFactor == 0
     }
 
+    NodeALV<T>* rebalance(NodeALV<T>* node) {
+        int balanceFactor = getBalanceFactor(node);
+
+        if (balanceFactor > 1) {
+            if (getBalanceFactor(node->left) < 0) {
+                node->left = rotateLeft(node->left);
+            }
+            return rotateRight(node);
+        }
+
+        if (balanceFactor < -1) {
+            if (getBalanceFactor(node->right) > 0) {
+                node->right = rotateRight(node->right);
+            }
+            return rotateLeft(node);
+        }
+
+        return node;
+    }
+
+    void updateHeight(NodeALV<T>* node) {
+        node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
+    }
+
+    // Joins two trees around a middle node, given every key in left is smaller
+    // than mid->key and every key in right is larger. O(|h(left) - h(right)|).
+    NodeALV<T>* join(NodeALV<T>* left, NodeALV<T>* mid, NodeALV<T>* right) {
+        if (getHeight(left) > getHeight(right) + 1) {
+            return joinRight(left, mid, right);
+        }
+        if (getHeight(right) > getHeight(left) + 1) {
+            return joinLeft(left, mid, right);
+        }
+        mid->left = left;
+        mid->right = right;
+        updateHeight(mid);
+        return mid;
+    }
+
+    NodeALV<T>* joinRight(NodeALV<T>* left, NodeALV<T>* mid, NodeALV<T>* right) {
+        if (getHeight(left) <= getHeight(right) + 1) {
+            mid->left = left;
+            mid->right = right;
+            updateHeight(mid);
+            return mid;
+        }
+        left->right = joinRight(left->right, mid, right);
+        updateHeight(left);
+        return rebalance(left);
+    }
+
+    NodeALV<T>* joinLeft(NodeALV<T>* left, NodeALV<T>* mid, NodeALV<T>* right) {
+        if (getHeight(right) <= getHeight(left) + 1) {
+            mid->left = left;
+            mid->right = right;
+            updateHeight(mid);
+            return mid;
+        }
+        right->left = joinLeft(left, mid, right->left);
+        updateHeight(right);
+        return rebalance(right);
+    }
+
+    // Splits the subtree at node into the keys below and above key in
+    // O(log n). The node holding key itself, if any, comes back detached.
+    void split(NodeALV<T>* node, const T& key, NodeALV<T>*& left, NodeALV<T>*& found, NodeALV<T>*& right) {
+        if (!node) {
+            left = found = right = nullptr;
+            return;
+        }
+
+        NodeALV<T>* lower = node->left;
+        NodeALV<T>* upper = node->right;
+        if (key < node->key) {
+            split(lower, key, left, found, right);
+            right = join(right, node, upper);
+        } else if (node->key < key) {
+            split(upper, key, left, found, right);
+            left = join(lower, node, left);
+        } else {
+            left = lower;
+            right = upper;
+            found = node;
+            node->left = node->right = nullptr;
+            node->height = 1;
+        }
+    }
+
+    // Merges an ascending range into the subtree at node: split once around
+    // the middle of the range, recurse on both halves, join the results.
+    template<typename RandomIt>
+    NodeALV<T>* unionSorted(NodeALV<T>* node, RandomIt first, RandomIt last) {
+        if (last - first <= BATCH_CUTOFF) {
+            for (; first != last; ++first) {
+                node = insert(node, *first);
+            }
+            return node;
+        }
+
+        RandomIt mid = first + (last - first) / 2;
+        RandomIt lo = mid;
+        RandomIt hi = mid + 1;
+        while (lo != first && !(*(lo - 1) < *mid)) {
+            --lo;
+        }
+        while (hi != last && !(*mid < *hi)) {
+            ++hi;
+        }
+
+        NodeALV<T>* left;
+        NodeALV<T>* found;
+        NodeALV<T>* right;
+        split(node, *mid, left, found, right);
+        if (!found) {
+            found = createNode(*mid);
+        }
+
+        left = unionSorted(left, first, lo);
+        right = unionSorted(right, hi, last);
+        return join(left, found, right);
+    }
+
+    // Detaches the largest node of the subtree at node; the rest stays balanced.
+    void splitLast(NodeALV<T>* node, NodeALV<T>*& rest, NodeALV<T>*& last) {
+        if (!node->right) {
+            rest = node->left;
+            last = node;
+            node->left = nullptr;
+            node->height = 1;
+            return;
+        }
+        NodeALV<T>* upper;
+        splitLast(node->right, upper, last);
+        rest = join(node->left, node, upper);
+    }
+
+    // Joins two trees without a middle key.
+    NodeALV<T>* join2(NodeALV<T>* left, NodeALV<T>* right) {
+        if (!left) {
+            return right;
+        }
+        if (!right) {
+            return left;
+        }
+        NodeALV<T>* rest;
+        NodeALV<T>* last;
+        splitLast(left, rest, last);
+        return join(rest, last, right);
+    }
+
+    // Runs both halves of a divide-and-conquer step, on the pool when the
+    // subtrees are tall enough. Each half collects unused nodes in its own list.
+    template<typename Lower, typename Upper>
+    void recurseHalves(ThreadPool* pool, int height, std::vector<NodeALV<T>*>& garbage, const Lower& lowerHalf, const Upper& upperHalf) {
+        if (pool && height >= PARALLEL_CUTOFF_HEIGHT) {
+            std::vector<NodeALV<T>*> upperGarbage;
+            pool->parallelInvoke([&] { lowerHalf(garbage); }, [&] { upperHalf(upperGarbage); });
+            garbage.insert(garbage.end(), upperGarbage.begin(), upperGarbage.end());
+        } else {
+            lowerHalf(garbage);
+            upperHalf(garbage);
+        }
+    }
+
+    NodeALV<T>* unionTrees(NodeALV<T>* a, NodeALV<T>* b, ThreadPool* pool, std::vector<NodeALV<T>*>& garbage) {
+        if (!a) {
+            return b;
+        }
+        if (!b) {
+            return a;
+        }
+
+        int height = std::min(getHeight(a), getHeight(b));
+        NodeALV<T>* lowerB = b->left;
+        NodeALV<T>* upperB = b->right;
+        NodeALV<T>* lowerA;
+        NodeALV<T>* found;
+        NodeALV<T>* upperA;
+        split(a, b->key, lowerA, found, upperA);
+        if (found) {
+            garbage.push_back(found);
+        }
+
+        NodeALV<T>* lower;
+        NodeALV<T>* upper;
+        recurseHalves(pool, height, garbage,
+                      [&](std::vector<NodeALV<T>*>& g) { lower = unionTrees(lowerA, lowerB, pool, g); },
+                      [&](std::vector<NodeALV<T>*>& g) { upper = unionTrees(upperA, upperB, pool, g); });
+        return join(lower, b, upper);
+    }
+
+    NodeALV<T>* intersectTrees(NodeALV<T>* a, NodeALV<T>* b, ThreadPool* pool, std::vector<NodeALV<T>*>& garbage) {
+        if (!a || !b) {
+            if (a) garbage.push_back(a);
+            if (b) garbage.push_back(b);
+            return nullptr;
+        }
+
+        int height = std::min(getHeight(a), getHeight(b));
+        NodeALV<T>* lowerB = b->left;
+        NodeALV<T>* upperB = b->right;
+        b->left = b->right = nullptr;
+        garbage.push_back(b);
+        NodeALV<T>* lowerA;
+        NodeALV<T>* found;
+        NodeALV<T>* upperA;
+        split(a, b->key, lowerA, found, upperA);
+
+        NodeALV<T>* lower;
+        NodeALV<T>* upper;
+        recurseHalves(pool, height, garbage,
+                      [&](std::vector<NodeALV<T>*>& g) { lower = intersectTrees(lowerA, lowerB, pool, g); },
+                      [&](std::vector<NodeALV<T>*>& g) { upper = intersectTrees(upperA, upperB, pool, g); });
+        return found ? join(lower, found, upper) : join2(lower, upper);
+    }
+
+    NodeALV<T>* differenceTrees(NodeALV<T>* a, NodeALV<T>* b, ThreadPool* pool, std::vector<NodeALV<T>*>& garbage) {
+        if (!a || !b) {
+            if (b) garbage.push_back(b);
+            return a;
+        }
+
+        int height = std::min(getHeight(a), getHeight(b));
+        NodeALV<T>* lowerB = b->left;
+        NodeALV<T>* upperB = b->right;
+        b->left = b->right = nullptr;
+        garbage.push_back(b);
+        NodeALV<T>* lowerA;
+        NodeALV<T>* found;
+        NodeALV<T>* upperA;
+        split(a, b->key, lowerA, found, upperA);
+        if (found) {
+            garbage.push_back(found);
+        }
+
+        NodeALV<T>* lower;
+        NodeALV<T>* upper;
+        recurseHalves(pool, height, garbage,
+                      [&](std::vector<NodeALV<T>*>& g) { lower = differenceTrees(lowerA, lowerB, pool, g); },
+                      [&](std::vector<NodeALV<T>*>& g) { upper = differenceTrees(upperA, upperB, pool, g); });
+        return join2(lower, upper);
+    }
+
     NodeALV<T>* minValueNode(NodeALV<T>* node) {
         NodeALV<T>* current = node;
         while (current->left != nullptr)
@@ -132,7 +574,7 @@ public:
                     *root = *temp;
                 }
 
-                delete temp;
+                destroyNode(temp);
             } else {
                 NodeALV<T>* temp = minValueNode(root->right);
                 root->key = temp->key;
@@ -167,14 +609,29 @@ public:
         return root;
     }
 
-    NodeALV<T>* search(NodeALV<T>* root, T key) {
-        if (root == nullptr || root->key == key)
-            return root;
-
-        if (root->key < key)
-            return search(root->right, key);
+    // One < per level down to a leaf, remembering the last node not below
+    // key; only that candidate is tested for equality. The step is a plain
+    // predicted branch rather than a cmov select: a correct guess lets the
+    // CPU start loading the next node before the compare resolves.
+    NodeALV<T>* search(NodeALV<T>* node, const T& key) const {
+        NodeALV<T>* candidate = nullptr;
+        while (node) {
+            if (node->key < key) {
+                node = node->right;
+            } else {
+                candidate = node;
+                node = node->left;
+            }
+        }
+        return candidate && !(key < candidate->key) ? candidate : nullptr;
+    }
 
-        return search(root->left, key);
+    static void prefetch(const NodeALV<T>* node) {
+#if defined(__GNUC__)
+        __builtin_prefetch(node);
+#else
+        (void)node;
+#endif
     }
 
     void printInOrder(NodeALV<T>* root) {
@@ -185,23 +642,247 @@ public:
         }
     }
 
+    // Iterative insert: the descent records the links it follows and the
+    // retrace stops at the first ancestor whose height did not change.
     void insert(T key) {
-        root = insert(root, key);
+        NodeALV<T>** path[MAX_HEIGHT];
+        int depth = 0;
+        NodeALV<T>** link = &root;
+
+        while (*link) {
+            NodeALV<T>* node = *link;
+            if (key < node->key) {
+                path[depth++] = link;
+                link = &node->left;
+            } else if (key > node->key) {
+                path[depth++] = link;
+                link = &node->right;
+            } else {
+                return;
+            }
+        }
+
+        *link = createNode(key);
+
+        while (depth > 0) {
+            link = path[--depth];
+            NodeALV<T>* node = *link;
+            int height = 1 + std::max(getHeight(node->left), getHeight(node->right));
+            if (height == node->height) {
+                return;
+            }
+            node->height = height;
+
+            int balanceFactor = getBalanceFactor(node);
+            if (balanceFactor > 1 || balanceFactor < -1) {
+                // A rotation after an insert restores the subtree's previous height.
+                *link = rebalance(node);
+                return;
+            }
+        }
     }
 
+    // Iterative delete: a node with two children takes its in-order successor's
+    // key, and the successor is unlinked in the same descent.
     void deleteNode(T key) {
-        root = deleteNode(root, key);
+        NodeALV<T>** path[MAX_HEIGHT];
+        int depth = 0;
+        NodeALV<T>** link = &root;
+        NodeALV<T>* target;
+
+        while (true) {
+            target = *link;
+            if (!target) {
+                return;
+            }
+            if (key < target->key) {
+                path[depth++] = link;
+                link = &target->left;
+            } else if (key > target->key) {
+                path[depth++] = link;
+                link = &target->right;
+            } else {
+                break;
+            }
+        }
+
+        NodeALV<T>* victim = target;
+        if (target->left && target->right) {
+            path[depth++] = link;
+            link = &target->right;
+            while ((*link)->left) {
+                path[depth++] = link;
+                link = &(*link)->left;
+            }
+            victim = *link;
+            target->key = victim->key;
+        }
+
+        *link = victim->left ? victim->left : victim->right;
+        destroyNode(victim);
+
+        while (depth > 0) {
+            link = path[--depth];
+            NodeALV<T>* node = *link;
+            int oldHeight = node->height;
+            node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
+            node = rebalance(node);
+            *link = node;
+            if (node->height == oldHeight) {
+                return;
+            }
+        }
     }
 
-    NodeALV<T>* search(T key) {
+    // Inserts an ascending range in O(m log(n/m + 1)) through split/join,
+    // instead of one root-to-leaf descent per key.
+    template<typename RandomIt>
+    void insert_batch(RandomIt first, RandomIt last) {
+        root = unionSorted(root, first, last);
+    }
+
+    template<typename Range>
+    void insert_batch(const Range& sortedKeys) {
+        insert_batch(std::begin(sortedKeys), std::end(sortedKeys));
+    }
+
+    // Set operations that consume other: its nodes are relinked into this tree
+    // with split/join in O(m log(n/m + 1)) work, and nodes left over on either
+    // side are freed. Given a pool, the two halves of every step above
+    // PARALLEL_CUTOFF_HEIGHT run as parallel tasks.
+    void union_with(AVL&& other, ThreadPool* pool = nullptr) {
+        std::vector<NodeALV<T>*> garbage;
+        alloc.adopt(other.alloc);
+        root = unionTrees(root, other.root, pool, garbage);
+        other.root = nullptr;
+        freeSubtrees(garbage);
+    }
+
+    void intersect_with(AVL&& other, ThreadPool* pool = nullptr) {
+        std::vector<NodeALV<T>*> garbage;
+        alloc.adopt(other.alloc);
+        root = intersectTrees(root, other.root, pool, garbage);
+        other.root = nullptr;
+        freeSubtrees(garbage);
+    }
+
+    void difference_with(AVL&& other, ThreadPool* pool = nullptr) {
+        std::vector<NodeALV<T>*> garbage;
+        alloc.adopt(other.alloc);
+        root = differenceTrees(root, other.root, pool, garbage);
+        other.root = nullptr;
+        freeSubtrees(garbage);
+    }
+
+    void freeSubtrees(const std::vector<NodeALV<T>*>& subtrees) {
+        for (NodeALV<T>* subtree : subtrees) {
+            destroyTree(subtree);
+        }
+    }
+
+    NodeALV<T>* search(const T& key) const {
         return search(root, key);
     }
 
+    // out[i] = search(keys[i]), with up to group lookups interleaved AMAC
+    // style: each step advances one lookup by a level, prefetches the child
+    // it moved to and switches to the next lookup, so the misses of the
+    // whole group are in flight at once instead of one after another.
+    void search_many(std::span<const T> keys, std::span<NodeALV<T>*> out, std::size_t group = SEARCH_GROUP) const {
+        if (out.size() < keys.size()) {
+            throw std::invalid_argument("AVL::search_many: out is shorter than keys");
+        }
+        group = std::clamp<std::size_t>(group, 1, MAX_SEARCH_GROUP);
+        NodeALV<T>* current[MAX_SEARCH_GROUP];
+        std::size_t index[MAX_SEARCH_GROUP];
+        std::size_t next = 0;
+        std::size_t active = 0;
+        for (; active < group && next < keys.size(); ++active, ++next) {
+            current[active] = root;
+            index[active] = next;
+        }
+
+        while (active > 0) {
+            for (std::size_t s = 0; s < active;) {
+                NodeALV<T>* node = current[s];
+                const T& key = keys[index[s]];
+                if (!node || node->key == key) {
+                    out[index[s]] = node;
+                    if (next < keys.size()) {
+                        current[s] = root;
+                        index[s] = next++;
+                        ++s;
+                    } else {
+                        --active;
+                        current[s] = current[active];
+                        index[s] = index[active];
+                    }
+                    continue;
+                }
+                node = node->key < key ? node->right : node->left;
+                prefetch(node);
+                current[s] = node;
+                ++s;
+            }
+        }
+    }
+
+    iterator begin() const {
+        iterator it(root);
+        it.pushLeftSpine(root);
+        return it;
+    }
+
+    iterator end() const {
+        return iterator(root);
+    }
+
+    // First key not less than key.
+    iterator lower_bound(const T& key) const {
+        return bound(key, false);
+    }
+
+    // First key greater than key.
+    iterator upper_bound(const T& key) const {
+        return bound(key, true);
+    }
+
+    std::pair<iterator, iterator> equal_range(const T& key) const {
+        return {lower_bound(key), upper_bound(key)};
+    }
+
+    // Immutable read-only copy in Eytzinger order, built by one in-order walk.
+    FrozenSet<T> freeze() const {
+        return FrozenSet<T>(begin(), end());
+    }
+
+    // Descends towards key and cuts the recorded path back to the last node
+    // that qualified as the bound.
+    iterator bound(const T& key, bool upper) const {
+        iterator it(root);
+        int found = 0;
+        for (NodeALV<T>* node = root; node;) {
+            it.path[it.depth++] = node;
+            bool goLeft = upper ? key < node->key : !(node->key < key);
+            if (goLeft) {
+                found = it.depth;
+                node = node->left;
+            } else {
+                node = node->right;
+            }
+        }
+        it.depth = found;
+        return it;
+    }
+
     void printInOrder() {
         std::cout << "In-order traversal: ";
         printInOrder(root);
         std::cout << std::endl;
     }
+
+private:
+    Alloc alloc;
 };
 
 #endif // AVL_H
@@ -0,0 +1,420 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <iostream>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include "NodeArena.h"
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
+// B+-tree set with cache-line-aligned nodes of at most NodeBytes bytes. Keys
+// live only in the leaves, which are chained left to right; inner nodes hold
+// separators, where every key in children[i + 1] is >= keys[i] and every key
+// in children[i] is below it. A node is searched by counting its keys below
+// the probe, which for signed 32- and 64-bit integers is done with AVX2 or
+// SSE4.2 compares when the build enables them, and with a scalar loop
+// otherwise.
+template<typename T, std::size_t NodeBytes = 256>
+class BTree {
+    static_assert(std::is_trivial_v<T>, "BTree keeps keys in raw arrays and moves them with memmove");
+
+public:
+    // 16 bytes per node go to the count and the leaf chain or child padding.
+    static constexpr std::size_t LEAF_CAPACITY = (NodeBytes - 16) / sizeof(T);
+    static constexpr std::size_t INNER_CAPACITY = (NodeBytes - 16) / (sizeof(T) + sizeof(void*));
+    static_assert(LEAF_CAPACITY >= 3 && INNER_CAPACITY >= 3, "NodeBytes is too small for this key type");
+
+    static constexpr std::size_t MIN_LEAF = LEAF_CAPACITY / 2;
+    static constexpr std::size_t MIN_INNER = INNER_CAPACITY / 2;
+
+    // Every inner node but the root has at least two children.
+    static constexpr int MAX_DEPTH = 64;
+
+    BTree() : root(nullptr), height(0), count(0) {}
+
+    BTree(const BTree&) = delete;
+    BTree& operator=(const BTree&) = delete;
+
+    void clear() {
+        leaves.release();
+        inners.release();
+        root = nullptr;
+        height = 0;
+        count = 0;
+    }
+
+    std::size_t size() const {
+        return count;
+    }
+
+    static constexpr std::size_t nodeSize() {
+        return sizeof(Leaf);
+    }
+
+    void insert(const T& key) {
+        if (!root) {
+            Leaf* leaf = createLeaf();
+            leaf->keys[0] = key;
+            leaf->count = 1;
+            root = leaf;
+            height = 1;
+            count = 1;
+            return;
+        }
+
+        Inner* path[MAX_DEPTH];
+        unsigned slot[MAX_DEPTH];
+        Leaf* leaf = descend(key, path, slot);
+        unsigned pos = rank<false>(leaf->keys, leaf->count, key);
+        if (pos < leaf->count && leaf->keys[pos] == key) {
+            return;
+        }
+        ++count;
+
+        if (leaf->count < LEAF_CAPACITY) {
+            insertAt(leaf->keys, leaf->count, pos, key);
+            ++leaf->count;
+            return;
+        }
+
+        Leaf* right = createLeaf();
+        unsigned half = LEAF_CAPACITY / 2;
+        right->count = LEAF_CAPACITY - half;
+        std::memcpy(right->keys, leaf->keys + half, right->count * sizeof(T));
+        leaf->count = half;
+        if (pos < half) {
+            insertAt(leaf->keys, leaf->count++, pos, key);
+        } else {
+            insertAt(right->keys, right->count++, pos - half, key);
+        }
+        right->next = leaf->next;
+        leaf->next = right;
+
+        T separator = right->keys[0];
+        void* child = right;
+        for (int level = height - 2; level >= 0; --level) {
+            Inner* inner = path[level];
+            unsigned i = slot[level];
+            if (inner->count < INNER_CAPACITY) {
+                insertAt(inner->keys, inner->count, i, separator);
+                insertAt(inner->children, inner->count + 1, i + 1, child);
+                ++inner->count;
+                return;
+            }
+            splitInner(inner, i, separator, child);
+        }
+
+        Inner* newRoot = createInner();
+        newRoot->count = 1;
+        newRoot->keys[0] = separator;
+        newRoot->children[0] = root;
+        newRoot->children[1] = child;
+        root = newRoot;
+        ++height;
+    }
+
+    void remove(const T& key) {
+        if (!root) {
+            return;
+        }
+
+        Inner* path[MAX_DEPTH];
+        unsigned slot[MAX_DEPTH];
+        Leaf* leaf = descend(key, path, slot);
+        unsigned pos = rank<false>(leaf->keys, leaf->count, key);
+        if (pos == leaf->count || leaf->keys[pos] != key) {
+            return;
+        }
+        eraseAt(leaf->keys, leaf->count, pos);
+        --leaf->count;
+        --count;
+
+        if (height == 1) {
+            if (leaf->count == 0) {
+                leaves.deallocate(leaf);
+                root = nullptr;
+                height = 0;
+            }
+            return;
+        }
+        if (leaf->count >= MIN_LEAF || !fixLeaf(path[height - 2], slot[height - 2], leaf)) {
+            return;
+        }
+
+        // A merge took a separator out of the parent, which may now underflow.
+        for (int level = height - 2; level > 0; --level) {
+            Inner* inner = path[level];
+            if (inner->count >= MIN_INNER || !fixInner(path[level - 1], slot[level - 1], inner)) {
+                return;
+            }
+        }
+
+        Inner* top = static_cast<Inner*>(root);
+        if (top->count == 0) {
+            root = top->children[0];
+            inners.deallocate(top);
+            --height;
+        }
+    }
+
+    bool search(const T& key) const {
+        if (!root) {
+            return false;
+        }
+        const void* node = root;
+        for (int level = 1; level < height; ++level) {
+            const Inner* inner = static_cast<const Inner*>(node);
+            node = inner->children[rank<true>(inner->keys, inner->count, key)];
+        }
+        const Leaf* leaf = static_cast<const Leaf*>(node);
+        unsigned pos = rank<false>(leaf->keys, leaf->count, key);
+        return pos < leaf->count && leaf->keys[pos] == key;
+    }
+
+    void printInOrder() {
+        const void* node = root;
+        for (int level = 1; level < height; ++level) {
+            node = static_cast<const Inner*>(node)->children[0];
+        }
+        for (const Leaf* leaf = static_cast<const Leaf*>(node); leaf; leaf = leaf->next) {
+            for (unsigned i = 0; i < leaf->count; ++i) {
+                std::cout << leaf->keys[i] << " ";
+            }
+        }
+        std::cout << std::endl;
+    }
+
+private:
+    // Keys come first so they start on a cache line. Vector loads may read
+    // past count into the rest of the node, never past its aligned end.
+    struct alignas(64) Leaf {
+        T keys[LEAF_CAPACITY];
+        Leaf* next;
+        std::uint32_t count;
+    };
+
+    struct alignas(64) Inner {
+        T keys[INNER_CAPACITY];
+        std::uint32_t count;
+        void* children[INNER_CAPACITY + 1];
+    };
+
+    static_assert(sizeof(Leaf) <= NodeBytes && sizeof(Inner) <= NodeBytes, "node exceeds NodeBytes");
+
+    Leaf* createLeaf() {
+        Leaf* leaf = new (leaves.allocate()) Leaf;
+        leaf->next = nullptr;
+        leaf->count = 0;
+        return leaf;
+    }
+
+    Inner* createInner() {
+        Inner* inner = new (inners.allocate()) Inner;
+        inner->count = 0;
+        return inner;
+    }
+
+    Leaf* descend(const T& key, Inner** path, unsigned* slot) const {
+        void* node = root;
+        for (int level = 0; level < height - 1; ++level) {
+            Inner* inner = static_cast<Inner*>(node);
+            unsigned i = rank<true>(inner->keys, inner->count, key);
+            path[level] = inner;
+            slot[level] = i;
+            node = inner->children[i];
+        }
+        return static_cast<Leaf*>(node);
+    }
+
+    template<typename U>
+    static void insertAt(U* items, unsigned size, unsigned pos, const U& item) {
+        std::memmove(items + pos + 1, items + pos, (size - pos) * sizeof(U));
+        items[pos] = item;
+    }
+
+    template<typename U>
+    static void eraseAt(U* items, unsigned size, unsigned pos) {
+        std::memmove(items + pos, items + pos + 1, (size - pos - 1) * sizeof(U));
+    }
+
+    // Splits a full inner node while inserting separator and child at slot i.
+    // On return separator and child hold what must go into the parent.
+    void splitInner(Inner* inner, unsigned i, T& separator, void*& child) {
+        T keys[INNER_CAPACITY + 1];
+        void* children[INNER_CAPACITY + 2];
+        std::memcpy(keys, inner->keys, INNER_CAPACITY * sizeof(T));
+        std::memcpy(children, inner->children, (INNER_CAPACITY + 1) * sizeof(void*));
+        insertAt(keys, INNER_CAPACITY, i, separator);
+        insertAt(children, INNER_CAPACITY + 1, i + 1, child);
+
+        unsigned leftKeys = (INNER_CAPACITY + 1) / 2;
+        Inner* right = createInner();
+        right->count = INNER_CAPACITY - leftKeys;
+        std::memcpy(right->keys, keys + leftKeys + 1, right->count * sizeof(T));
+        std::memcpy(right->children, children + leftKeys + 1, (right->count + 1) * sizeof(void*));
+        inner->count = leftKeys;
+        std::memcpy(inner->keys, keys, leftKeys * sizeof(T));
+        std::memcpy(inner->children, children, (leftKeys + 1) * sizeof(void*));
+
+        separator = keys[leftKeys];
+        child = right;
+    }
+
+    // Refills leaf, children[i] of parent, from a sibling or merges it with
+    // one. Returns whether a merge removed a separator from parent.
+    bool fixLeaf(Inner* parent, unsigned i, Leaf* leaf) {
+        if (i > 0) {
+            Leaf* left = static_cast<Leaf*>(parent->children[i - 1]);
+            if (left->count > MIN_LEAF) {
+                insertAt(leaf->keys, leaf->count++, 0, left->keys[--left->count]);
+                parent->keys[i - 1] = leaf->keys[0];
+                return false;
+            }
+        }
+        if (i < parent->count) {
+            Leaf* right = static_cast<Leaf*>(parent->children[i + 1]);
+            if (right->count > MIN_LEAF) {
+                leaf->keys[leaf->count++] = right->keys[0];
+                eraseAt(right->keys, right->count--, 0);
+                parent->keys[i] = right->keys[0];
+                return false;
+            }
+        }
+
+        unsigned s = i > 0 ? i - 1 : i;
+        Leaf* left = static_cast<Leaf*>(parent->children[s]);
+        Leaf* right = static_cast<Leaf*>(parent->children[s + 1]);
+        std::memcpy(left->keys + left->count, right->keys, right->count * sizeof(T));
+        left->count += right->count;
+        left->next = right->next;
+        eraseAt(parent->keys, parent->count, s);
+        eraseAt(parent->children, parent->count + 1, s + 1);
+        --parent->count;
+        leaves.deallocate(right);
+        return true;
+    }
+
+    // Same as fixLeaf for an inner node; borrowed children rotate through
+    // the parent's separator.
+    bool fixInner(Inner* parent, unsigned i, Inner* node) {
+        if (i > 0) {
+            Inner* left = static_cast<Inner*>(parent->children[i - 1]);
+            if (left->count > MIN_INNER) {
+                insertAt(node->keys, node->count, 0, parent->keys[i - 1]);
+                insertAt(node->children, node->count + 1, 0, left->children[left->count]);
+                ++node->count;
+                parent->keys[i - 1] = left->keys[--left->count];
+                return false;
+            }
+        }
+        if (i < parent->count) {
+            Inner* right = static_cast<Inner*>(parent->children[i + 1]);
+            if (right->count > MIN_INNER) {
+                node->keys[node->count] = parent->keys[i];
+                node->children[node->count + 1] = right->children[0];
+                ++node->count;
+                parent->keys[i] = right->keys[0];
+                eraseAt(right->keys, right->count, 0);
+                eraseAt(right->children, right->count + 1, 0);
+                --right->count;
+                return false;
+            }
+        }
+
+        unsigned s = i > 0 ? i - 1 : i;
+        Inner* left = static_cast<Inner*>(parent->children[s]);
+        Inner* right = static_cast<Inner*>(parent->children[s + 1]);
+        left->keys[left->count] = parent->keys[s];
+        std::memcpy(left->keys + left->count + 1, right->keys, right->count * sizeof(T));
+        std::memcpy(left->children + left->count + 1, right->children, (right->count + 1) * sizeof(void*));
+        left->count += 1 + right->count;
+        eraseAt(parent->keys, parent->count, s);
+        eraseAt(parent->children, parent->count + 1, s + 1);
+        --parent->count;
+        inners.deallocate(right);
+        return true;
+    }
+
+    // Number of keys below key, or not above it when Inclusive. Keys are
+    // sorted, so a vector that is not all hits ends the scan.
+    template<bool Inclusive>
+    static unsigned rank(const T* keys, unsigned n, const T& key) {
+        constexpr bool signedInt = std::is_integral_v<T> && std::is_signed_v<T>;
+#if defined(__AVX2__)
+        if constexpr (signedInt && sizeof(T) == 4) {
+            __m256i probe = _mm256_set1_epi32(key);
+            return rankVectors<Inclusive, 8>(keys, n, [&](const T* at) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at));
+                __m256i hit = Inclusive ? _mm256_cmpgt_epi32(v, probe) : _mm256_cmpgt_epi32(probe, v);
+                return static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(hit)));
+            });
+        }
+        if constexpr (signedInt && sizeof(T) == 8) {
+            __m256i probe = _mm256_set1_epi64x(key);
+            return rankVectors<Inclusive, 4>(keys, n, [&](const T* at) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at));
+                __m256i hit = Inclusive ? _mm256_cmpgt_epi64(v, probe) : _mm256_cmpgt_epi64(probe, v);
+                return static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(hit)));
+            });
+        }
+#elif defined(__SSE4_2__)
+        if constexpr (signedInt && sizeof(T) == 4) {
+            __m128i probe = _mm_set1_epi32(key);
+            return rankVectors<Inclusive, 4>(keys, n, [&](const T* at) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at));
+                __m128i hit = Inclusive ? _mm_cmpgt_epi32(v, probe) : _mm_cmpgt_epi32(probe, v);
+                return static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(hit)));
+            });
+        }
+        if constexpr (signedInt && sizeof(T) == 8) {
+            __m128i probe = _mm_set1_epi64x(key);
+            return rankVectors<Inclusive, 2>(keys, n, [&](const T* at) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at));
+                __m128i hit = Inclusive ? _mm_cmpgt_epi64(v, probe) : _mm_cmpgt_epi64(probe, v);
+                return static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(hit)));
+            });
+        }
+#endif
+        unsigned below = 0;
+        for (unsigned i = 0; i < n; ++i) {
+            below += Inclusive ? !(key < keys[i]) : keys[i] < key;
+        }
+        return below;
+    }
+
+    // compare returns one bit per lane: keys below the probe, or for
+    // Inclusive keys above it, which are inverted here.
+    template<bool Inclusive, unsigned Lanes, typename Compare>
+    static unsigned rankVectors(const T* keys, unsigned n, const Compare& compare) {
+        constexpr unsigned all = (1u << Lanes) - 1;
+        unsigned below = 0;
+        for (unsigned i = 0; i < n; i += Lanes) {
+            unsigned mask = compare(keys + i);
+            if (Inclusive) {
+                mask = ~mask & all;
+            }
+            if (n - i < Lanes) {
+                mask &= (1u << (n - i)) - 1;
+            }
+            below += std::popcount(mask);
+            if (mask != all) {
+                break;
+            }
+        }
+        return below;
+    }
+
+    void* root;
+    int height;
+    std::size_t count;
+    NodeArena<Leaf> leaves;
+    NodeArena<Inner> inners;
+};
+
+#endif // BTREE_H
@@ -0,0 +1,198 @@
+#ifndef BENCHMARK_RESULTS_H
+#define BENCHMARK_RESULTS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Keeps value, and the work that produced it, from being optimized away.
+template<typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile char sink;
+    sink = *reinterpret_cast<const volatile char*>(&value);
+#endif
+}
+
+// Statistics over the ns/op of repeated runs of one phase. The confidence
+// interval is for the median and comes from order statistics, so it makes
+// no assumption about the distribution and a run slowed down by the
+// scheduler moves it by at most one rank. It covers at least 95% from six
+// runs on; with fewer it is the range of the samples.
+struct Summary {
+    std::size_t runs = 0;
+    double median = 0;
+    double p95 = 0;
+    double mean = 0;
+    double ciLow = 0;
+    double ciHigh = 0;
+};
+
+inline Summary summarize(std::vector<double> samples) {
+    Summary summary;
+    std::size_t n = samples.size();
+    summary.runs = n;
+    if (n == 0) {
+        return summary;
+    }
+    std::sort(samples.begin(), samples.end());
+    summary.median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    // Nearest rank.
+    summary.p95 = samples[static_cast<std::size_t>(std::ceil(0.95 * n)) - 1];
+    double sum = 0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+    summary.mean = sum / n;
+
+    // The median lies below the (j + 1)-th smallest sample with probability
+    // P(Binomial(n, 1/2) <= j); take the largest j that keeps each tail
+    // within 2.5%.
+    std::size_t j = 0;
+    double term = std::pow(0.5, static_cast<double>(n));
+    double tail = term;
+    for (std::size_t i = 0; i + 1 < n / 2; ++i) {
+        term = term * (n - i) / (i + 1);
+        if (tail + term > 0.025) {
+            break;
+        }
+        tail += term;
+        j = i + 1;
+    }
+    summary.ciLow = samples[j];
+    summary.ciHigh = samples[n - 1 - j];
+    return summary;
+}
+
+struct BenchmarkResult {
+    std::string engine;
+    std::string workload;
+    std::string phase;
+    std::size_t size = 0;
+    Summary nsPerOp;
+};
+
+// Summarizes and keeps every measured phase, for the JSON and CSV output.
+class BenchmarkRecorder {
+public:
+    BenchmarkRecorder(int warmupRuns, int measuredRuns) : warmup(warmupRuns), measured(measuredRuns) {}
+
+    int warmupRuns() const {
+        return warmup;
+    }
+
+    int measuredRuns() const {
+        return measured;
+    }
+
+    const Summary& record(const std::string& engine, const std::string& workload, const std::string& phase,
+                          std::size_t size, const std::vector<double>& nsPerOp) {
+        recorded.push_back({engine, workload, phase, size, summarize(nsPerOp)});
+        return recorded.back().nsPerOp;
+    }
+
+    const std::vector<BenchmarkResult>& results() const {
+        return recorded;
+    }
+
+private:
+    int warmup;
+    int measured;
+    std::vector<BenchmarkResult> recorded;
+};
+
+inline constexpr const char* CSV_HEADER = "engine,workload,phase,size,runs,median_ns,p95_ns,mean_ns,ci_low_ns,ci_high_ns";
+
+// Labels are written as they are, so they must not contain commas.
+inline void writeCsv(const std::string& path, const std::vector<BenchmarkResult>& results) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("cannot write " + path);
+    }
+    out.precision(10);
+    out << CSV_HEADER << "\n";
+    for (const BenchmarkResult& r : results) {
+        out << r.engine << "," << r.workload << "," << r.phase << "," << r.size << "," << r.nsPerOp.runs << ","
+            << r.nsPerOp.median << "," << r.nsPerOp.p95 << "," << r.nsPerOp.mean << ","
+            << r.nsPerOp.ciLow << "," << r.nsPerOp.ciHigh << "\n";
+    }
+}
+
+inline std::vector<BenchmarkResult> readCsv(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("cannot read " + path);
+    }
+    std::string line;
+    if (!std::getline(in, line) || line != CSV_HEADER) {
+        throw std::runtime_error(path + ": not a benchmark CSV file");
+    }
+    std::vector<BenchmarkResult> results;
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        std::vector<std::string> fields;
+        std::stringstream row(line);
+        for (std::string field; std::getline(row, field, ',');) {
+            fields.push_back(field);
+        }
+        if (fields.size() != 10) {
+            throw std::runtime_error(path + ": malformed row: " + line);
+        }
+        BenchmarkResult r;
+        r.engine = fields[0];
+        r.workload = fields[1];
+        r.phase = fields[2];
+        try {
+            r.size = std::stoull(fields[3]);
+            r.nsPerOp.runs = std::stoull(fields[4]);
+            r.nsPerOp.median = std::stod(fields[5]);
+            r.nsPerOp.p95 = std::stod(fields[6]);
+            r.nsPerOp.mean = std::stod(fields[7]);
+            r.nsPerOp.ciLow = std::stod(fields[8]);
+            r.nsPerOp.ciHigh = std::stod(fields[9]);
+        } catch (const std::logic_error&) {
+            throw std::runtime_error(path + ": malformed row: " + line);
+        }
+        results.push_back(r);
+    }
+    return results;
+}
+
+inline std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+inline void writeJson(const std::string& path, const std::vector<BenchmarkResult>& results) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("cannot write " + path);
+    }
+    out.precision(10);
+    out << "{\"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& r = results[i];
+        out << (i ? ",\n  " : "\n  ") << "{\"engine\": " << jsonString(r.engine) << ", \"workload\": " << jsonString(r.workload)
+            << ", \"phase\": " << jsonString(r.phase) << ", \"size\": " << r.size << ", \"runs\": " << r.nsPerOp.runs
+            << ", \"median_ns\": " << r.nsPerOp.median << ", \"p95_ns\": " << r.nsPerOp.p95 << ", \"mean_ns\": " << r.nsPerOp.mean
+            << ", \"ci_low_ns\": " << r.nsPerOp.ciLow << ", \"ci_high_ns\": " << r.nsPerOp.ciHigh << "}";
+    }
+    out << "\n]}\n";
+}
+
+#endif // BENCHMARK_RESULTS_H
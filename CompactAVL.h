@@ -0,0 +1,242 @@
+#ifndef COMPACT_AVL_H
+#define COMPACT_AVL_H
+
+#include <iostream>
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include "NodeArena.h"
+
+// AVL node that stores the balance factor (left height minus right height,
+// always -1, 0 or +1 between operations) instead of the height. The byte sits
+// in the padding after a 4-byte key, so a CompactNodeALV<int> is 24 bytes
+// where NodeALV<int> is 32.
+template<typename T>
+class CompactNodeALV {
+public:
+    T key;
+    signed char balance;
+    CompactNodeALV* left;
+    CompactNodeALV* right;
+
+    CompactNodeALV(T k) : key(k), balance(0), left(nullptr), right(nullptr) {}
+};
+
+// AVL tree over CompactNodeALV. Insert and delete retrace with the classic
+// balance-factor rules, so rebalancing never reads a child to learn its height.
+template<typename T, typename Alloc = NodeArena<CompactNodeALV<T>>>
+class CompactAVL {
+public:
+    static constexpr int MAX_HEIGHT = 64;
+
+    CompactNodeALV<T>* root;
+
+    CompactAVL() : root(nullptr) {}
+
+    CompactAVL(const CompactAVL&) = delete;
+    CompactAVL& operator=(const CompactAVL&) = delete;
+
+    ~CompactAVL() {
+        clear();
+    }
+
+    static constexpr std::size_t nodeSize() {
+        return sizeof(CompactNodeALV<T>);
+    }
+
+    void clear() {
+        if constexpr (Alloc::releasesInBulk && std::is_trivially_destructible_v<T>) {
+            alloc.release();
+        } else {
+            destroyTree(root);
+        }
+        root = nullptr;
+    }
+
+    void insert(T key) {
+        CompactNodeALV<T>** path[MAX_HEIGHT];
+        int depth = 0;
+        CompactNodeALV<T>** link = &root;
+
+        while (*link) {
+            CompactNodeALV<T>* node = *link;
+            if (key < node->key) {
+                path[depth++] = link;
+                link = &node->left;
+            } else if (key > node->key) {
+                path[depth++] = link;
+                link = &node->right;
+            } else {
+                return;
+            }
+        }
+
+        CompactNodeALV<T>* child = createNode(key);
+        *link = child;
+
+        // Each step up, the child's subtree has grown by one level.
+        while (depth > 0) {
+            link = path[--depth];
+            CompactNodeALV<T>* node = *link;
+            node->balance += node->left == child ? 1 : -1;
+            if (node->balance == 0) {
+                return;
+            }
+            if (node->balance == 2 || node->balance == -2) {
+                // A rotation after an insert restores the subtree's previous height.
+                *link = rebalance(node);
+                return;
+            }
+            child = node;
+        }
+    }
+
+    void deleteNode(T key) {
+        CompactNodeALV<T>** path[MAX_HEIGHT];
+        bool wentLeft[MAX_HEIGHT];
+        int depth = 0;
+        CompactNodeALV<T>** link = &root;
+        CompactNodeALV<T>* target;
+
+        while (true) {
+            target = *link;
+            if (!target) {
+                return;
+            }
+            if (key < target->key) {
+                path[depth] = link;
+                wentLeft[depth++] = true;
+                link = &target->left;
+            } else if (key > target->key) {
+                path[depth] = link;
+                wentLeft[depth++] = false;
+                link = &target->right;
+            } else {
+                break;
+            }
+        }
+
+        CompactNodeALV<T>* victim = target;
+        if (target->left && target->right) {
+            path[depth] = link;
+            wentLeft[depth++] = false;
+            link = &target->right;
+            while ((*link)->left) {
+                path[depth] = link;
+                wentLeft[depth++] = true;
+                link = &(*link)->left;
+            }
+            victim = *link;
+            target->key = victim->key;
+        }
+
+        *link = victim->left ? victim->left : victim->right;
+        destroyNode(victim);
+
+        // Each step up, the side we came from has shrunk by one level.
+        while (depth > 0) {
+            link = path[--depth];
+            CompactNodeALV<T>* node = *link;
+            node->balance += wentLeft[depth] ? -1 : 1;
+            if (node->balance == 1 || node->balance == -1) {
+                return;
+            }
+            if (node->balance != 0) {
+                node = rebalance(node);
+                *link = node;
+                if (node->balance != 0) {
+                    return;
+                }
+            }
+        }
+    }
+
+    // Same descent as AVL::search.
+    CompactNodeALV<T>* search(const T& key) const {
+        CompactNodeALV<T>* node = root;
+        CompactNodeALV<T>* candidate = nullptr;
+        while (node) {
+            if (node->key < key) {
+                node = node->right;
+            } else {
+                candidate = node;
+                node = node->left;
+            }
+        }
+        return candidate && !(key < candidate->key) ? candidate : nullptr;
+    }
+
+    void printInOrder() {
+        printInOrder(root);
+        std::cout << std::endl;
+    }
+
+private:
+    CompactNodeALV<T>* createNode(T key) {
+        return new (alloc.allocate()) CompactNodeALV<T>(key);
+    }
+
+    void destroyNode(CompactNodeALV<T>* node) {
+        node->~CompactNodeALV<T>();
+        alloc.deallocate(node);
+    }
+
+    void destroyTree(CompactNodeALV<T>* node) {
+        if (node) {
+            destroyTree(node->left);
+            destroyTree(node->right);
+            destroyNode(node);
+        }
+    }
+
+    // The rotations derive the new balance factors from the old ones alone;
+    // a double rotation is two single ones.
+    CompactNodeALV<T>* rotateRight(CompactNodeALV<T>* y) {
+        CompactNodeALV<T>* x = y->left;
+        y->left = x->right;
+        x->right = y;
+
+        y->balance = y->balance - 1 - std::max<signed char>(x->balance, 0);
+        x->balance = x->balance - 1 + std::min<signed char>(y->balance, 0);
+        return x;
+    }
+
+    CompactNodeALV<T>* rotateLeft(CompactNodeALV<T>* x) {
+        CompactNodeALV<T>* y = x->right;
+        x->right = y->left;
+        y->left = x;
+
+        x->balance = x->balance + 1 - std::min<signed char>(y->balance, 0);
+        y->balance = y->balance + 1 + std::max<signed char>(x->balance, 0);
+        return y;
+    }
+
+    CompactNodeALV<T>* rebalance(CompactNodeALV<T>* node) {
+        if (node->balance > 1) {
+            if (node->left->balance < 0) {
+                node->left = rotateLeft(node->left);
+            }
+            return rotateRight(node);
+        }
+        if (node->balance < -1) {
+            if (node->right->balance > 0) {
+                node->right = rotateRight(node->right);
+            }
+            return rotateLeft(node);
+        }
+        return node;
+    }
+
+    void printInOrder(CompactNodeALV<T>* node) {
+        if (node != nullptr) {
+            printInOrder(node->left);
+            std::cout << node->key << " ";
+            printInOrder(node->right);
+        }
+    }
+
+    Alloc alloc;
+};
+
+#endif // COMPACT_AVL_H
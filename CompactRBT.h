@@ -0,0 +1,334 @@
+#ifndef COMPACT_RBT_H
+#define COMPACT_RBT_H
+
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include "NodeArena.h"
+
+// Red-black tree with a compact node: the colour lives in the low bit of the
+// parent pointer, so a node is three pointers plus the value, and every empty
+// link points at a black sentinel owned by the tree instead of nullptr. The
+// fix-up loops can then read colours and parents of leaves without null checks.
+// Nodes come from a NodeArena, so no per-node allocator header is paid either.
+template<typename T>
+class CompactRBT {
+private:
+    struct Links {
+        uintptr_t parentAndColor;
+        Links* left;
+        Links* right;
+    };
+
+    struct CompactNode : Links {
+        T data;
+
+        CompactNode(const T& value) : data(value) {}
+    };
+
+    static constexpr uintptr_t RED = 1;
+
+    Links nil;
+    Links* root;
+    NodeArena<CompactNode> alloc;
+
+public:
+    CompactRBT() : root(&nil) {
+        nil.parentAndColor = 0;
+        nil.left = nil.right = &nil;
+    }
+
+    // The sentinel lives inside the tree, so the tree cannot move.
+    CompactRBT(const CompactRBT&) = delete;
+    CompactRBT& operator=(const CompactRBT&) = delete;
+
+    ~CompactRBT() {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            destroyTree(root);
+        }
+    }
+
+    static constexpr size_t nodeSize() {
+        return sizeof(CompactNode);
+    }
+
+    void insert(const T& value) {
+        CompactNode* node = new (alloc.allocate()) CompactNode(value);
+        Links* parent = &nil;
+        Links* current = root;
+        while (current != &nil) {
+            parent = current;
+            current = value < data(current) ? current->left : current->right;
+        }
+
+        node->parentAndColor = reinterpret_cast<uintptr_t>(parent) | RED;
+        node->left = node->right = &nil;
+        if (parent == &nil) {
+            root = node;
+        } else if (value < data(parent)) {
+            parent->left = node;
+        } else {
+            parent->right = node;
+        }
+        insertFixUp(node);
+    }
+
+    void remove(const T& value) {
+        Links* node = find(value);
+        if (node != nullptr) {
+            deleteNode(node);
+        }
+    }
+
+    bool search(const T& value) const {
+        return find(value) != nullptr;
+    }
+
+private:
+    static const T& data(const Links* node) {
+        return static_cast<const CompactNode*>(node)->data;
+    }
+
+    static Links* parentOf(const Links* node) {
+        return reinterpret_cast<Links*>(node->parentAndColor & ~RED);
+    }
+
+    static void setParent(Links* node, Links* parent) {
+        node->parentAndColor = reinterpret_cast<uintptr_t>(parent) | (node->parentAndColor & RED);
+    }
+
+    static bool isRed(const Links* node) {
+        return node->parentAndColor & RED;
+    }
+
+    static void setRed(Links* node) {
+        node->parentAndColor |= RED;
+    }
+
+    static void setBlack(Links* node) {
+        node->parentAndColor &= ~RED;
+    }
+
+    static void copyColor(Links* node, const Links* from) {
+        node->parentAndColor = (node->parentAndColor & ~RED) | (from->parentAndColor & RED);
+    }
+
+    // Same descent as AVL::search; returns nullptr when value is absent.
+    Links* find(const T& value) const {
+        Links* node = root;
+        Links* candidate = nullptr;
+        while (node != &nil) {
+            if (data(node) < value) {
+                node = node->right;
+            } else {
+                candidate = node;
+                node = node->left;
+            }
+        }
+        return candidate != nullptr && !(value < data(candidate)) ? candidate : nullptr;
+    }
+
+    void destroyTree(Links* node) {
+        if (node != &nil) {
+            destroyTree(node->left);
+            destroyTree(node->right);
+            static_cast<CompactNode*>(node)->~CompactNode();
+        }
+    }
+
+    void rotateLeft(Links* node) {
+        Links* rightChild = node->right;
+        Links* parent = parentOf(node);
+        node->right = rightChild->left;
+        if (rightChild->left != &nil) {
+            setParent(rightChild->left, node);
+        }
+        setParent(rightChild, parent);
+        if (parent == &nil) {
+            root = rightChild;
+        } else if (node == parent->left) {
+            parent->left = rightChild;
+        } else {
+            parent->right = rightChild;
+        }
+        rightChild->left = node;
+        setParent(node, rightChild);
+    }
+
+    void rotateRight(Links* node) {
+        Links* leftChild = node->left;
+        Links* parent = parentOf(node);
+        node->left = leftChild->right;
+        if (leftChild->right != &nil) {
+            setParent(leftChild->right, node);
+        }
+        setParent(leftChild, parent);
+        if (parent == &nil) {
+            root = leftChild;
+        } else if (node == parent->right) {
+            parent->right = leftChild;
+        } else {
+            parent->left = leftChild;
+        }
+        leftChild->right = node;
+        setParent(node, leftChild);
+    }
+
+    // The sentinel above the root is black, so the loop needs no root check.
+    void insertFixUp(Links* node) {
+        while (isRed(parentOf(node))) {
+            Links* parent = parentOf(node);
+            Links* grandparent = parentOf(parent);
+
+            if (parent == grandparent->left) {
+                Links* uncle = grandparent->right;
+                if (isRed(uncle)) {
+                    setBlack(parent);
+                    setBlack(uncle);
+                    setRed(grandparent);
+                    node = grandparent;
+                } else {
+                    if (node == parent->right) {
+                        node = parent;
+                        rotateLeft(node);
+                        parent = parentOf(node);
+                    }
+                    setBlack(parent);
+                    setRed(grandparent);
+                    rotateRight(grandparent);
+                }
+            } else {
+                Links* uncle = grandparent->left;
+                if (isRed(uncle)) {
+                    setBlack(parent);
+                    setBlack(uncle);
+                    setRed(grandparent);
+                    node = grandparent;
+                } else {
+                    if (node == parent->left) {
+                        node = parent;
+                        rotateRight(node);
+                        parent = parentOf(node);
+                    }
+                    setBlack(parent);
+                    setRed(grandparent);
+                    rotateLeft(grandparent);
+                }
+            }
+        }
+        setBlack(root);
+    }
+
+    // Unlike nullptr, the sentinel can carry a parent, so transplant always
+    // records one and deleteFixUp can climb from an empty position.
+    void transplant(Links* u, Links* v) {
+        Links* parent = parentOf(u);
+        if (parent == &nil) {
+            root = v;
+        } else if (u == parent->left) {
+            parent->left = v;
+        } else {
+            parent->right = v;
+        }
+        setParent(v, parent);
+    }
+
+    void deleteNode(Links* node) {
+        Links* temp = node;
+        Links* x;
+        bool removedBlack = !isRed(temp);
+
+        if (node->left == &nil) {
+            x = node->right;
+            transplant(node, node->right);
+        } else if (node->right == &nil) {
+            x = node->left;
+            transplant(node, node->left);
+        } else {
+            temp = node->right;
+            while (temp->left != &nil) {
+                temp = temp->left;
+            }
+            removedBlack = !isRed(temp);
+            x = temp->right;
+
+            if (parentOf(temp) == node) {
+                setParent(x, temp);
+            } else {
+                transplant(temp, temp->right);
+                temp->right = node->right;
+                setParent(temp->right, temp);
+            }
+
+            transplant(node, temp);
+            temp->left = node->left;
+            setParent(temp->left, temp);
+            copyColor(temp, node);
+        }
+
+        static_cast<CompactNode*>(node)->~CompactNode();
+        alloc.deallocate(static_cast<CompactNode*>(node));
+
+        if (removedBlack) {
+            deleteFixUp(x);
+        }
+    }
+
+    void deleteFixUp(Links* node) {
+        while (node != root && !isRed(node)) {
+            Links* parent = parentOf(node);
+            if (node == parent->left) {
+                Links* sibling = parent->right;
+                if (isRed(sibling)) {
+                    setBlack(sibling);
+                    setRed(parent);
+                    rotateLeft(parent);
+                    sibling = parent->right;
+                }
+                if (!isRed(sibling->left) && !isRed(sibling->right)) {
+                    setRed(sibling);
+                    node = parent;
+                } else {
+                    if (!isRed(sibling->right)) {
+                        setBlack(sibling->left);
+                        setRed(sibling);
+                        rotateRight(sibling);
+                        sibling = parent->right;
+                    }
+                    copyColor(sibling, parent);
+                    setBlack(parent);
+                    setBlack(sibling->right);
+                    rotateLeft(parent);
+                    node = root;
+                }
+            } else {
+                Links* sibling = parent->left;
+                if (isRed(sibling)) {
+                    setBlack(sibling);
+                    setRed(parent);
+                    rotateRight(parent);
+                    sibling = parent->left;
+                }
+                if (!isRed(sibling->right) && !isRed(sibling->left)) {
+                    setRed(sibling);
+                    node = parent;
+                } else {
+                    if (!isRed(sibling->left)) {
+                        setBlack(sibling->right);
+                        setRed(sibling);
+                        rotateLeft(sibling);
+                        sibling = parent->left;
+                    }
+                    copyColor(sibling, parent);
+                    setBlack(parent);
+                    setBlack(sibling->left);
+                    rotateRight(parent);
+                    node = root;
+                }
+            }
+        }
+        setBlack(node);
+    }
+};
+
+#endif // COMPACT_RBT_H
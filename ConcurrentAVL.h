@@ -0,0 +1,560 @@
+#ifndef CONCURRENT_AVL_H
+#define CONCURRENT_AVL_H
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include "Epoch.h"
+#include "SpinLock.h"
+
+// A node whose key has been deleted while it still had two children stays in
+// the tree as a routing node (present == false) until a rebalance can splice
+// it out.
+// What a lookup reads comes first; with an int key the node is 40 bytes.
+template<typename T>
+class ConcurrentNodeALV {
+public:
+    const T key;
+    std::atomic<std::uint32_t> version;
+    std::atomic<ConcurrentNodeALV*> left;
+    std::atomic<ConcurrentNodeALV*> right;
+    std::atomic<int> height;
+    std::atomic<bool> present;
+    SpinLock lock;
+    std::atomic<ConcurrentNodeALV*> parent;
+
+    ConcurrentNodeALV(const T& k, int h, bool p, ConcurrentNodeALV* up)
+        : key(k), version(0), left(nullptr), right(nullptr), height(h), present(p), parent(up) {}
+};
+
+// Concurrent AVL tree after Bronson, Casper, Chafi and Olukotun, "A Practical
+// Concurrent Binary Search Tree" (PPoPP 2010). Lookups take no locks: they
+// walk down hand over hand, re-reading each node's version after following a
+// child pointer, and back up to retry if a rotation shrank the node under
+// them. Writers lock only the nodes they change, parents before children.
+// Balance is relaxed: a thread that damages a node's height or balance repairs
+// it after the update, so the tree is a strict AVL tree whenever it is
+// quiescent. Unlinked nodes are retired to Epoch, and every operation pins
+// the calling thread while it runs.
+template<typename T>
+class ConcurrentAVL {
+public:
+    using Node = ConcurrentNodeALV<T>;
+
+    // Spins on a changing node's version before falling back to its lock.
+    static constexpr int SPIN_COUNT = 100;
+
+    ConcurrentAVL() : holder(new Node(T(), 0, false, nullptr)) {}
+
+    ConcurrentAVL(const ConcurrentAVL&) = delete;
+    ConcurrentAVL& operator=(const ConcurrentAVL&) = delete;
+
+    // No other thread may still be using the tree.
+    ~ConcurrentAVL() {
+        destroyTree(holder);
+    }
+
+    bool search(const T& key) const {
+        Epoch::Guard guard;
+        while (true) {
+            Result result = attemptSearch(key);
+            if (result != RETRY) {
+                return result == YES;
+            }
+        }
+    }
+
+    // Both return whether the set changed.
+    bool insert(const T& key) {
+        return update(key, true);
+    }
+
+    bool deleteNode(const T& key) {
+        return update(key, false);
+    }
+
+    // Not linearizable with concurrent updates.
+    void printInOrder() {
+        Epoch::Guard guard;
+        printInOrder(load(holder->right));
+        std::cout << std::endl;
+    }
+
+private:
+    enum Result { NO, YES, RETRY };
+
+    static constexpr std::uint32_t UNLINKED = 1;
+    static constexpr std::uint32_t SHRINKING = 2;
+
+    // nodeCondition() returns the height a node should have, or one of these.
+    static constexpr int UNLINK_REQUIRED = -1;
+    static constexpr int REBALANCE_REQUIRED = -2;
+    static constexpr int NOTHING_REQUIRED = -3;
+
+    template<typename V>
+    static V load(const std::atomic<V>& field) {
+        return field.load(std::memory_order_acquire);
+    }
+
+    template<typename V>
+    static void store(std::atomic<V>& field, V value) {
+        field.store(value, std::memory_order_release);
+    }
+
+    static std::atomic<Node*>& child(Node* node, bool left) {
+        return left ? node->left : node->right;
+    }
+
+    static int height(Node* node) {
+        return node ? load(node->height) : 0;
+    }
+
+    static bool isUnlinked(std::uint32_t version) {
+        return (version & UNLINKED) != 0;
+    }
+
+    static bool isShrinkingOrUnlinked(std::uint32_t version) {
+        return (version & (UNLINKED | SHRINKING)) != 0;
+    }
+
+    // A shrink marks the version while it runs and leaves it one count
+    // higher; readers that saw the old version retry. The count wraps after
+    // 2^30 shrinks of one node, far more than a reader can sleep through.
+    static std::uint32_t beginChange(std::uint32_t version) {
+        return version | SHRINKING;
+    }
+
+    static std::uint32_t endChange(std::uint32_t version) {
+        return (version | SHRINKING) + SHRINKING;
+    }
+
+    // The thread shrinking node holds its lock, so once the spin gives up,
+    // taking the lock waits out the change.
+    static void waitUntilChanged(Node* node, std::uint32_t version) {
+        for (int spins = 0; spins < SPIN_COUNT; ++spins) {
+            if (load(node->version) != version) {
+                return;
+            }
+        }
+        std::lock_guard<SpinLock> lock(node->lock);
+    }
+
+    // Walks down from the holder, whose version never changes. Before a
+    // child is trusted, its parent's version is checked again, so the range
+    // of keys the walk assumes for the child is still the right one. A walk
+    // that fails validation starts over from the root.
+    Result attemptSearch(const T& key) const {
+        Node* node = holder;
+        std::uint32_t nodeVersion = load(holder->version);
+        bool goLeft = false;
+        while (true) {
+            Node* next = load(child(node, goLeft));
+            if (load(node->version) != nodeVersion) {
+                return RETRY;
+            }
+            if (!next) {
+                return NO;
+            }
+            if (next->key == key) {
+                return load(next->present) ? YES : NO;
+            }
+            std::uint32_t nextVersion = load(next->version);
+            if (isShrinkingOrUnlinked(nextVersion)) {
+                waitUntilChanged(next, nextVersion);
+                continue;
+            }
+            if (next != load(child(node, goLeft)) || load(node->version) != nodeVersion) {
+                continue;
+            }
+            node = next;
+            nodeVersion = nextVersion;
+            goLeft = key < next->key;
+        }
+    }
+
+    bool update(const T& key, bool insert) {
+        Epoch::Guard guard;
+        while (true) {
+            Result result = attemptUpdate(key, insert);
+            if (result != RETRY) {
+                return result == YES;
+            }
+        }
+    }
+
+    // Same walk as attemptSearch. A missing key is linked in under the last
+    // node, locked and validated; an empty tree hangs the first node off the
+    // holder the same way.
+    Result attemptUpdate(const T& key, bool insert) {
+        Node* node = holder;
+        std::uint32_t nodeVersion = load(holder->version);
+        bool goLeft = false;
+        while (true) {
+            Node* next = load(child(node, goLeft));
+            if (load(node->version) != nodeVersion) {
+                return RETRY;
+            }
+            if (!next) {
+                if (!insert) {
+                    return NO;
+                }
+                Node* damaged;
+                {
+                    std::lock_guard<SpinLock> lock(node->lock);
+                    if (load(node->version) != nodeVersion) {
+                        return RETRY;
+                    }
+                    if (load(child(node, goLeft))) {
+                        // Lost a race with another insert; node is still valid.
+                        continue;
+                    }
+                    store(child(node, goLeft), new Node(key, 1, true, node));
+                    damaged = fixHeightLocked(node);
+                }
+                fixHeightAndRebalance(damaged);
+                return YES;
+            }
+            if (next->key == key) {
+                return attemptNodeUpdate(insert, node, next);
+            }
+            std::uint32_t nextVersion = load(next->version);
+            if (isShrinkingOrUnlinked(nextVersion)) {
+                waitUntilChanged(next, nextVersion);
+                continue;
+            }
+            if (next != load(child(node, goLeft)) || load(node->version) != nodeVersion) {
+                continue;
+            }
+            node = next;
+            nodeVersion = nextVersion;
+            goLeft = key < next->key;
+        }
+    }
+
+    // Sets or clears node's key. A delete splices the node out when it has
+    // at most one child, which needs the parent locked as well; parent may be
+    // stale, in which case the whole update retries.
+    Result attemptNodeUpdate(bool insert, Node* parent, Node* node) {
+        if (!insert) {
+            if (!load(node->present)) {
+                return NO;
+            }
+            if (!load(node->left) || !load(node->right)) {
+                Node* damaged;
+                {
+                    std::lock_guard<SpinLock> parentLock(parent->lock);
+                    if (isUnlinked(load(parent->version)) || load(node->parent) != parent) {
+                        return RETRY;
+                    }
+                    {
+                        std::lock_guard<SpinLock> nodeLock(node->lock);
+                        if (!load(node->present)) {
+                            return NO;
+                        }
+                        if (!attemptUnlinkLocked(parent, node)) {
+                            return RETRY;
+                        }
+                    }
+                    damaged = fixHeightLocked(parent);
+                }
+                fixHeightAndRebalance(damaged);
+                return YES;
+            }
+        }
+
+        std::lock_guard<SpinLock> lock(node->lock);
+        if (isUnlinked(load(node->version))) {
+            return RETRY;
+        }
+        if (load(node->present) == insert) {
+            return NO;
+        }
+        if (!insert && (!load(node->left) || !load(node->right))) {
+            // The node lost a child meanwhile; it can be unlinked now.
+            return RETRY;
+        }
+        store(node->present, insert);
+        return YES;
+    }
+
+    // Both parent and node are locked. Heights are left for the caller.
+    static bool attemptUnlinkLocked(Node* parent, Node* node) {
+        bool isLeft = load(parent->left) == node;
+        if (!isLeft && load(parent->right) != node) {
+            return false;
+        }
+        Node* left = load(node->left);
+        Node* right = load(node->right);
+        if (left && right) {
+            return false;
+        }
+        Node* splice = left ? left : right;
+        store(child(parent, isLeft), splice);
+        if (splice) {
+            store(splice->parent, parent);
+        }
+        store(node->version, UNLINKED);
+        store(node->present, false);
+        Epoch::retire(node);
+        return true;
+    }
+
+    static int nodeCondition(Node* node) {
+        Node* left = load(node->left);
+        Node* right = load(node->right);
+        if ((!left || !right) && !load(node->present)) {
+            return UNLINK_REQUIRED;
+        }
+        int leftHeight = height(left);
+        int rightHeight = height(right);
+        int repaired = 1 + std::max(leftHeight, rightHeight);
+        int balance = leftHeight - rightHeight;
+        if (balance < -1 || balance > 1) {
+            return REBALANCE_REQUIRED;
+        }
+        return load(node->height) != repaired ? repaired : NOTHING_REQUIRED;
+    }
+
+    // Walks up from a damaged node until nothing is left to repair, taking
+    // only the locks each step needs. A rotation that hands back a damaged
+    // node below it skips the height fix above it, so once the chain ends,
+    // the path from the lowest rebalanced node to the root is checked again.
+    void fixHeightAndRebalance(Node* node) {
+        Node* recheck = nullptr;
+        while (true) {
+            int condition = NOTHING_REQUIRED;
+            if (node && load(node->parent) && !isUnlinked(load(node->version))) {
+                condition = nodeCondition(node);
+            }
+            if (condition == NOTHING_REQUIRED) {
+                if (!recheck) {
+                    return;
+                }
+                node = damagedAncestor(recheck);
+                recheck = nullptr;
+            } else if (condition != UNLINK_REQUIRED && condition != REBALANCE_REQUIRED) {
+                std::lock_guard<SpinLock> lock(node->lock);
+                node = fixHeightLocked(node);
+            } else {
+                Node* parent = load(node->parent);
+                std::lock_guard<SpinLock> parentLock(parent->lock);
+                if (!isUnlinked(load(parent->version)) && load(node->parent) == parent) {
+                    std::lock_guard<SpinLock> nodeLock(node->lock);
+                    if (!recheck) {
+                        recheck = node;
+                    }
+                    node = rebalanceLocked(parent, node);
+                }
+            }
+        }
+    }
+
+    // The lowest node from node up to the root that needs a repair. The
+    // holder has no parent, so the walk stops there.
+    static Node* damagedAncestor(Node* node) {
+        for (; node && load(node->parent); node = load(node->parent)) {
+            if (!isUnlinked(load(node->version)) && nodeCondition(node) != NOTHING_REQUIRED) {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    // Fixes a locked node's height and returns the next node this thread
+    // must repair, or nullptr.
+    static Node* fixHeightLocked(Node* node) {
+        int condition = nodeCondition(node);
+        if (condition == REBALANCE_REQUIRED || condition == UNLINK_REQUIRED) {
+            return node;
+        }
+        if (condition == NOTHING_REQUIRED) {
+            return nullptr;
+        }
+        store(node->height, condition);
+        return load(node->parent);
+    }
+
+    // parent and node are locked.
+    Node* rebalanceLocked(Node* parent, Node* node) {
+        Node* left = load(node->left);
+        Node* right = load(node->right);
+        if ((!left || !right) && !load(node->present)) {
+            if (attemptUnlinkLocked(parent, node)) {
+                return fixHeightLocked(parent);
+            }
+            return node;
+        }
+        int leftHeight = height(left);
+        int rightHeight = height(right);
+        int balance = leftHeight - rightHeight;
+        if (balance > 1) {
+            return rebalanceToward(parent, node, left, rightHeight, true);
+        }
+        if (balance < -1) {
+            return rebalanceToward(parent, node, right, leftHeight, false);
+        }
+        int repaired = 1 + std::max(leftHeight, rightHeight);
+        if (load(node->height) != repaired) {
+            store(node->height, repaired);
+            return fixHeightLocked(parent);
+        }
+        return nullptr;
+    }
+
+    // node's tall child is on side tallLeft and its other subtree has height
+    // shortHeight; rotates the tall side up. parent and node are locked. The
+    // comments name the sides as if tallLeft were true.
+    Node* rebalanceToward(Node* parent, Node* node, Node* tall, int shortHeight, bool tallLeft) {
+        std::lock_guard<SpinLock> tallLock(tall->lock);
+        if (load(tall->height) - shortHeight <= 1) {
+            return node;
+        }
+        Node* inner = load(child(tall, !tallLeft));
+        int outerHeight = height(load(child(tall, tallLeft)));
+        int innerHeight = height(inner);
+        if (outerHeight >= innerHeight) {
+            return rotateLocked(parent, node, tall, shortHeight, outerHeight, inner, innerHeight, tallLeft);
+        }
+        {
+            std::lock_guard<SpinLock> innerLock(inner->lock);
+            innerHeight = load(inner->height);
+            if (outerHeight >= innerHeight) {
+                return rotateLocked(parent, node, tall, shortHeight, outerHeight, inner, innerHeight, tallLeft);
+            }
+            // A double rotation is only used when it leaves tall balanced;
+            // otherwise tall is fixed on its own first.
+            int innerOuterHeight = height(load(child(inner, tallLeft)));
+            int balance = outerHeight - innerOuterHeight;
+            if (balance >= -1 && balance <= 1) {
+                return rotateDoubleLocked(parent, node, tall, shortHeight, outerHeight, inner, innerOuterHeight, tallLeft);
+            }
+        }
+        return rebalanceToward(node, tall, inner, outerHeight, !tallLeft);
+    }
+
+    /* Single rotation lifting L over N:
+             N            L
+            / \          / \
+           L   R  ->   LL   N
+          / \              / \
+         LL  LR          LR   R
+       N shrinks, so its version changes. */
+    static Node* rotateLocked(Node* parent, Node* n, Node* nL, int hR, int hLL, Node* nLR, int hLR, bool tallLeft) {
+        std::uint32_t version = load(n->version);
+        bool nIsLeft = load(parent->left) == n;
+        store(n->version, beginChange(version));
+
+        store(child(n, tallLeft), nLR);
+        if (nLR) {
+            store(nLR->parent, n);
+        }
+        store(child(nL, !tallLeft), n);
+        store(child(parent, nIsLeft), nL);
+        // Parent pointers are set top-down, so walks up never see a cycle.
+        store(nL->parent, parent);
+        store(n->parent, nL);
+
+        int hN = 1 + std::max(hLR, hR);
+        store(n->height, hN);
+        store(nL->height, 1 + std::max(hLL, hN));
+        store(n->version, endChange(version));
+
+        int balanceN = hLR - hR;
+        if (balanceN < -1 || balanceN > 1) {
+            return n;
+        }
+        int balanceL = hLL - hN;
+        if (balanceL < -1 || balanceL > 1) {
+            return nL;
+        }
+        return fixHeightLocked(parent);
+    }
+
+    /* Double rotation lifting LR over L and N:
+             N               LR
+            / \            /    \
+           L   R  ->      L      N
+          / \            / \    / \
+         LL  LR        LL LRL LRR  R
+            /  \
+          LRL  LRR
+       N and L both shrink. */
+    static Node* rotateDoubleLocked(Node* parent, Node* n, Node* nL, int hR, int hLL, Node* nLR, int hLRL, bool tallLeft) {
+        std::uint32_t version = load(n->version);
+        std::uint32_t leftVersion = load(nL->version);
+        bool nIsLeft = load(parent->left) == n;
+        Node* nLRL = load(child(nLR, tallLeft));
+        Node* nLRR = load(child(nLR, !tallLeft));
+        int hLRR = height(nLRR);
+        store(n->version, beginChange(version));
+        store(nL->version, beginChange(leftVersion));
+
+        store(child(n, tallLeft), nLRR);
+        if (nLRR) {
+            store(nLRR->parent, n);
+        }
+        store(child(nL, !tallLeft), nLRL);
+        if (nLRL) {
+            store(nLRL->parent, nL);
+        }
+        store(child(nLR, tallLeft), nL);
+        store(child(nLR, !tallLeft), n);
+        store(child(parent, nIsLeft), nLR);
+        store(nLR->parent, parent);
+        store(nL->parent, nLR);
+        store(n->parent, nLR);
+
+        int hN = 1 + std::max(hLRR, hR);
+        store(n->height, hN);
+        int hL = 1 + std::max(hLL, hLRL);
+        store(nL->height, hL);
+        store(nLR->height, 1 + std::max(hL, hN));
+        store(n->version, endChange(version));
+        store(nL->version, endChange(leftVersion));
+
+        // L can be left a routing node with at most one child; both it and
+        // LR are locked, so it is spliced out here.
+        if ((!nLRL || hLL == 0) && !load(nL->present)) {
+            attemptUnlinkLocked(nLR, nL);
+            hL = std::max(hLL, hLRL);
+            store(nLR->height, 1 + std::max(hL, hN));
+        }
+
+        int balanceN = hLRR - hR;
+        if (balanceN < -1 || balanceN > 1) {
+            return n;
+        }
+        if ((!nLRR || hR == 0) && !load(n->present)) {
+            return n;
+        }
+        int balanceLR = hL - hN;
+        if (balanceLR < -1 || balanceLR > 1) {
+            return nLR;
+        }
+        return fixHeightLocked(parent);
+    }
+
+    static void destroyTree(Node* node) {
+        if (node) {
+            destroyTree(load(node->left));
+            destroyTree(load(node->right));
+            delete node;
+        }
+    }
+
+    static void printInOrder(Node* node) {
+        if (node) {
+            printInOrder(load(node->left));
+            if (load(node->present)) {
+                std::cout << node->key << " ";
+            }
+            printInOrder(load(node->right));
+        }
+    }
+
+    Node* holder;
+};
+
+#endif // CONCURRENT_AVL_H
@@ -0,0 +1,204 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Process-wide epoch-based reclamation. A thread pins itself with a Guard
+// while it reads shared nodes; a writer that unlinks a node retires it, and
+// the node is freed only after every thread pinned at the time has unpinned.
+// Concretely, the global epoch can only advance once every pinned thread has
+// seen the current one, and objects retired in epoch e are freed once the
+// global epoch reaches e + 2.
+class Epoch {
+public:
+    static constexpr unsigned MAX_THREADS = 256;
+
+    // Retired objects a thread accumulates before it tries to advance the
+    // epoch and free what has become safe.
+    static constexpr std::size_t COLLECT_THRESHOLD = 64;
+
+private:
+    struct Record;
+
+public:
+    class Guard {
+    public:
+        Guard() : record(Epoch::local()) {
+            if (record->nesting++ == 0) {
+                std::uint64_t epoch = Epoch::domain().globalEpoch.load(std::memory_order_seq_cst);
+                record->epoch.store(epoch, std::memory_order_relaxed);
+                // Publish the pin before reading anything it protects.
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() {
+            if (--record->nesting == 0) {
+                record->epoch.store(QUIESCENT, std::memory_order_release);
+            }
+        }
+
+    private:
+        Record* record;
+    };
+
+    // Frees object with reclaim(object) once no pinned thread can reach it.
+    // The object must already be unreachable for threads that pin later.
+    static void retire(void* object, void (*reclaim)(void*)) {
+        Record* record = local();
+        Domain& d = domain();
+        std::uint64_t epoch = d.globalEpoch.load(std::memory_order_seq_cst);
+        Limbo& bucket = record->limbo[epoch % 3];
+        if (bucket.epoch != epoch) {
+            // The bucket last filled three or more epochs ago.
+            drain(bucket);
+            bucket.epoch = epoch;
+        }
+        bucket.objects.emplace_back(object, reclaim);
+        if (++record->retiredSinceCollect >= COLLECT_THRESHOLD) {
+            record->retiredSinceCollect = 0;
+            collect(record);
+        }
+    }
+
+    template<typename T>
+    static void retire(T* object) {
+        retire(const_cast<void*>(static_cast<const void*>(object)), [](void* p) { delete static_cast<T*>(p); });
+    }
+
+private:
+    static constexpr std::uint64_t QUIESCENT = 0;
+
+    struct Limbo {
+        std::uint64_t epoch = 0;
+        std::vector<std::pair<void*, void (*)(void*)>> objects;
+    };
+
+    struct alignas(64) Record {
+        std::atomic<std::uint64_t> epoch{QUIESCENT};
+        std::atomic<bool> claimed{false};
+        unsigned nesting = 0;
+        std::size_t retiredSinceCollect = 0;
+        Limbo limbo[3];
+    };
+
+    struct Domain {
+        std::atomic<std::uint64_t> globalEpoch{1};
+        Record records[MAX_THREADS];
+        std::mutex orphanLock;
+        std::vector<Limbo> orphans;
+
+        ~Domain() {
+            for (Limbo& limbo : orphans) {
+                drain(limbo);
+            }
+        }
+    };
+
+    // Claims a record for the calling thread on first use and hands its
+    // unfreed objects to the domain when the thread exits.
+    struct Handle {
+        Record* record = nullptr;
+
+        ~Handle() {
+            if (!record) {
+                return;
+            }
+            Domain& d = domain();
+            {
+                std::lock_guard<std::mutex> lock(d.orphanLock);
+                for (Limbo& limbo : record->limbo) {
+                    if (!limbo.objects.empty()) {
+                        d.orphans.push_back(std::move(limbo));
+                        limbo.objects.clear();
+                    }
+                }
+            }
+            record->retiredSinceCollect = 0;
+            record->claimed.store(false, std::memory_order_release);
+        }
+    };
+
+    static Domain& domain() {
+        static Domain d;
+        return d;
+    }
+
+    static Record* local() {
+        thread_local Handle handle;
+        if (!handle.record) {
+            Domain& d = domain();
+            for (Record& record : d.records) {
+                bool expected = false;
+                if (!record.claimed.load(std::memory_order_relaxed) &&
+                    record.claimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    handle.record = &record;
+                    break;
+                }
+            }
+            if (!handle.record) {
+                throw std::runtime_error("Epoch: more than MAX_THREADS threads");
+            }
+        }
+        return handle.record;
+    }
+
+    // Advances the global epoch if every pinned thread has caught up with
+    // it, then frees this thread's buckets and any orphans that are old enough.
+    static void collect(Record* self) {
+        Domain& d = domain();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::uint64_t epoch = d.globalEpoch.load(std::memory_order_seq_cst);
+        bool caughtUp = true;
+        for (Record& record : d.records) {
+            if (!record.claimed.load(std::memory_order_acquire)) {
+                continue;
+            }
+            std::uint64_t pinned = record.epoch.load(std::memory_order_seq_cst);
+            if (pinned != QUIESCENT && pinned != epoch) {
+                caughtUp = false;
+                break;
+            }
+        }
+        if (caughtUp && d.globalEpoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst)) {
+            ++epoch;
+        }
+
+        for (Limbo& bucket : self->limbo) {
+            if (bucket.epoch + 2 <= epoch) {
+                drain(bucket);
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(d.orphanLock, std::try_to_lock);
+        if (lock.owns_lock()) {
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < d.orphans.size(); ++i) {
+                if (d.orphans[i].epoch + 2 <= epoch) {
+                    drain(d.orphans[i]);
+                } else if (kept++ != i) {
+                    d.orphans[kept - 1] = std::move(d.orphans[i]);
+                }
+            }
+            d.orphans.resize(kept);
+        }
+    }
+
+    static void drain(Limbo& limbo) {
+        for (auto& [object, reclaim] : limbo.objects) {
+            reclaim(object);
+        }
+        limbo.objects.clear();
+    }
+};
+
+#endif // EPOCH_H
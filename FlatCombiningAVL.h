@@ -0,0 +1,193 @@
+#ifndef FLAT_COMBINING_AVL_H
+#define FLAT_COMBINING_AVL_H
+
+#include <algorithm>
+#include <atomic>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "AVL.h"
+#include "SpinLock.h"
+
+// Flat-combining front end for AVL, after Hendler, Incze, Shavit and
+// Tzafrir, "Flat Combining and the Synchronization-Parallelism Tradeoff"
+// (SPAA 2010). A thread publishes its request in a slot of its own and tries
+// to take the combiner lock; whoever holds it collects every pending request,
+// applies them as sorted batches and hands the results back. The tree stays
+// single-threaded and hot in the combiner's cache, and a thread that loses
+// the race waits on its own slot's cache line rather than on a shared lock.
+template<typename T>
+class FlatCombiningAVL {
+public:
+    static constexpr unsigned MAX_THREADS = 256;
+
+    // Passes over the slots per turn as combiner, so requests published
+    // while a batch runs are picked up without another lock handoff.
+    static constexpr int COMBINE_PASSES = 3;
+
+    static constexpr int SPINS_BEFORE_YIELD = 64;
+
+    FlatCombiningAVL() : used(0) {}
+
+    FlatCombiningAVL(const FlatCombiningAVL&) = delete;
+    FlatCombiningAVL& operator=(const FlatCombiningAVL&) = delete;
+
+    void insert(const T& key) {
+        submit(INSERT, key);
+    }
+
+    void deleteNode(const T& key) {
+        submit(DELETE, key);
+    }
+
+    bool search(const T& key) {
+        return submit(SEARCH, key);
+    }
+
+private:
+    enum Op : unsigned char { INSERT, DELETE, SEARCH };
+
+    struct alignas(64) Slot {
+        std::atomic<bool> pending{false};
+        Op op = SEARCH;
+        bool result = false;
+        T key{};
+    };
+
+    struct Request {
+        T key;
+        unsigned slot;
+    };
+
+    // Gives each live thread its own slot index for as long as it runs.
+    struct Handle {
+        unsigned index;
+
+        Handle() : index(MAX_THREADS) {
+            for (unsigned i = 0; i < MAX_THREADS; ++i) {
+                bool expected = false;
+                if (!taken(i).load(std::memory_order_relaxed) &&
+                    taken(i).compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    index = i;
+                    return;
+                }
+            }
+            throw std::runtime_error("FlatCombiningAVL: more than MAX_THREADS threads");
+        }
+
+        ~Handle() {
+            taken(index).store(false, std::memory_order_release);
+        }
+    };
+
+    static std::atomic<bool>& taken(unsigned index) {
+        static std::atomic<bool> flags[MAX_THREADS];
+        return flags[index];
+    }
+
+    static unsigned threadIndex() {
+        thread_local Handle handle;
+        return handle.index;
+    }
+
+    bool submit(Op op, const T& key) {
+        unsigned index = threadIndex();
+        unsigned seen = used.load(std::memory_order_relaxed);
+        while (seen <= index && !used.compare_exchange_weak(seen, index + 1, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+
+        Slot& slot = slots[index];
+        slot.key = key;
+        slot.op = op;
+        slot.pending.store(true, std::memory_order_release);
+        for (int spins = 0; slot.pending.load(std::memory_order_acquire); ++spins) {
+            if (combiner.try_lock()) {
+                combine();
+                combiner.unlock();
+            } else if (spins >= SPINS_BEFORE_YIELD) {
+                std::this_thread::yield();
+            }
+        }
+        return slot.result;
+    }
+
+    void combine() {
+        for (int pass = 0; pass < COMBINE_PASSES; ++pass) {
+            searches.clear();
+            deletes.clear();
+            inserts.clear();
+            unsigned count = used.load(std::memory_order_acquire);
+            for (unsigned i = 0; i < count; ++i) {
+                Slot& slot = slots[i];
+                if (slot.pending.load(std::memory_order_acquire)) {
+                    std::vector<Request>& group = slot.op == SEARCH ? searches : slot.op == DELETE ? deletes : inserts;
+                    group.push_back({slot.key, i});
+                }
+            }
+            if (searches.empty() && deletes.empty() && inserts.empty()) {
+                return;
+            }
+
+            // Every request in a pass is concurrent with the others, so any
+            // order is a valid one: lookups see the tree before the pass's
+            // updates, and deletes go before inserts.
+            if (!searches.empty()) {
+                sortedKeys(searches);
+                found.resize(keys.size());
+                tree.search_many(std::span<const T>(keys), std::span<NodeALV<T>*>(found));
+                for (std::size_t i = 0; i < searches.size(); ++i) {
+                    slots[searches[i].slot].result = found[i] != nullptr;
+                }
+                release(searches);
+            }
+            if (!deletes.empty()) {
+                sortedKeys(deletes);
+                if (static_cast<long>(keys.size()) <= AVL<T>::BATCH_CUTOFF) {
+                    for (const T& key : keys) {
+                        tree.deleteNode(key);
+                    }
+                } else {
+                    AVL<T> batch;
+                    batch.build_from_sorted(keys.begin(), keys.end());
+                    tree.difference_with(std::move(batch));
+                }
+                release(deletes);
+            }
+            if (!inserts.empty()) {
+                sortedKeys(inserts);
+                tree.insert_batch(keys);
+                release(inserts);
+            }
+        }
+    }
+
+    // Sorts requests by key and copies the keys, in that order, to keys.
+    void sortedKeys(std::vector<Request>& requests) {
+        std::sort(requests.begin(), requests.end(), [](const Request& a, const Request& b) { return a.key < b.key; });
+        keys.clear();
+        for (const Request& request : requests) {
+            keys.push_back(request.key);
+        }
+    }
+
+    void release(const std::vector<Request>& requests) {
+        for (const Request& request : requests) {
+            slots[request.slot].pending.store(false, std::memory_order_release);
+        }
+    }
+
+    Slot slots[MAX_THREADS];
+    alignas(64) std::atomic<unsigned> used;
+    alignas(64) SpinLock combiner;
+
+    // Only touched by the combiner.
+    AVL<T> tree;
+    std::vector<Request> searches;
+    std::vector<Request> deletes;
+    std::vector<Request> inserts;
+    std::vector<T> keys;
+    std::vector<NodeALV<T>*> found;
+};
+
+#endif // FLAT_COMBINING_AVL_H
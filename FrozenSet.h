@@ -0,0 +1,189 @@
+#ifndef FROZEN_SET_H
+#define FROZEN_SET_H
+
+#include <bit>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+// Immutable sorted set stored in Eytzinger (BFS) order: the root is at index
+// 1 and the children of k are at 2k and 2k + 1, so the top levels of every
+// lookup share the same few cache lines. Lookups compute the next index
+// arithmetically instead of branching on the comparison, which leaves the
+// memory addresses of the levels below free to be prefetched.
+template<typename T>
+class FrozenSet {
+public:
+    // Keys per 64-byte line; prefetching k * LINE_KEYS fetches the whole
+    // block of descendants log2(LINE_KEYS) levels down.
+    static constexpr std::size_t LINE_KEYS = 64 / sizeof(T) > 0 ? 64 / sizeof(T) : 1;
+
+    // Independent searches advanced in lockstep by the batch contains.
+    static constexpr std::size_t BATCH_WIDTH = 16;
+
+    FrozenSet() : keys(nullptr), count(0), levels(0) {}
+
+    // Builds from an ascending range without duplicates in O(n).
+    template<typename ForwardIt>
+    FrozenSet(ForwardIt first, ForwardIt last) : FrozenSet() {
+        count = std::distance(first, last);
+        if (count == 0) {
+            return;
+        }
+        keys = static_cast<T*>(::operator new((count + 1) * sizeof(T), std::align_val_t(64)));
+        std::size_t constructed = 0;
+        try {
+            fill(1, first, constructed);
+        } catch (...) {
+            destroy(constructed);
+            throw;
+        }
+        levels = std::bit_width(count);
+    }
+
+    FrozenSet(FrozenSet&& other) noexcept : keys(other.keys), count(other.count), levels(other.levels) {
+        other.keys = nullptr;
+        other.count = 0;
+        other.levels = 0;
+    }
+
+    FrozenSet& operator=(FrozenSet&& other) noexcept {
+        if (this != &other) {
+            destroy(count);
+            keys = other.keys;
+            count = other.count;
+            levels = other.levels;
+            other.keys = nullptr;
+            other.count = 0;
+            other.levels = 0;
+        }
+        return *this;
+    }
+
+    FrozenSet(const FrozenSet&) = delete;
+    FrozenSet& operator=(const FrozenSet&) = delete;
+
+    ~FrozenSet() {
+        destroy(count);
+    }
+
+    std::size_t size() const {
+        return count;
+    }
+
+    bool contains(const T& key) const {
+        std::size_t k = 1;
+        while (k <= count) {
+            prefetch(k * LINE_KEYS);
+            k = 2 * k + (keys[k] < key);
+        }
+        return found(k, key);
+    }
+
+    // Answers out[i] = contains(queries[i]). Searches run BATCH_WIDTH at a
+    // time, one level per pass, so their cache misses overlap instead of
+    // queueing behind each other.
+    void contains(std::span<const T> queries, std::span<bool> out) const {
+        if (out.size() < queries.size()) {
+            throw std::invalid_argument("FrozenSet::contains: out is shorter than queries");
+        }
+        std::size_t k[BATCH_WIDTH];
+        std::size_t i = 0;
+        for (; i + BATCH_WIDTH <= queries.size(); i += BATCH_WIDTH) {
+            searchGroup(&queries[i], BATCH_WIDTH, k);
+            for (std::size_t j = 0; j < BATCH_WIDTH; ++j) {
+                out[i + j] = found(k[j], queries[i + j]);
+            }
+        }
+        if (i < queries.size()) {
+            std::size_t rest = queries.size() - i;
+            searchGroup(&queries[i], rest, k);
+            for (std::size_t j = 0; j < rest; ++j) {
+                out[i + j] = found(k[j], queries[i + j]);
+            }
+        }
+    }
+
+private:
+    // In-order walk of the implicit tree, consuming the sorted input.
+    template<typename ForwardIt>
+    void fill(std::size_t k, ForwardIt& it, std::size_t& constructed) {
+        if (k <= count) {
+            fill(2 * k, it, constructed);
+            new (&keys[k]) T(*it);
+            ++constructed;
+            ++it;
+            fill(2 * k + 1, it, constructed);
+        }
+    }
+
+    // Every level above the last is full, so those steps need no bounds
+    // check; a missing node on the last level counts as "go right", which
+    // found() undoes together with the other right turns.
+    void searchGroup(const T* queries, std::size_t width, std::size_t* k) const {
+        for (std::size_t j = 0; j < width; ++j) {
+            k[j] = 1;
+        }
+        if (count == 0) {
+            return;
+        }
+        for (std::size_t level = 1; level < levels; ++level) {
+            for (std::size_t j = 0; j < width; ++j) {
+                prefetch(k[j] * LINE_KEYS);
+                k[j] = 2 * k[j] + (keys[k[j]] < queries[j]);
+            }
+        }
+        for (std::size_t j = 0; j < width; ++j) {
+            k[j] = 2 * k[j] + (k[j] > count || keys[k[j]] < queries[j]);
+        }
+    }
+
+    // After the descent, dropping the trailing right turns and the left turn
+    // before them leaves the index of the smallest key >= the query.
+    bool found(std::size_t k, const T& key) const {
+        k >>= std::countr_one(k) + 1;
+        return k != 0 && !(key < keys[k]);
+    }
+
+    void prefetch(std::size_t k) const {
+#if defined(__GNUC__)
+        // Prefetches never fault, so running past the end is harmless.
+        __builtin_prefetch(reinterpret_cast<const char*>(keys) + k * sizeof(T));
+#else
+        (void)k;
+#endif
+    }
+
+    void destroy(std::size_t constructed) {
+        if (!keys) {
+            return;
+        }
+        // fill() constructs in in-order position, not index order, so walk
+        // the same order to destroy exactly what was built.
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            destroyInOrder(1, constructed);
+        }
+        ::operator delete(keys, std::align_val_t(64));
+        keys = nullptr;
+    }
+
+    void destroyInOrder(std::size_t k, std::size_t& remaining) {
+        if (k <= count && remaining > 0) {
+            destroyInOrder(2 * k, remaining);
+            if (remaining > 0) {
+                keys[k].~T();
+                --remaining;
+            }
+            destroyInOrder(2 * k + 1, remaining);
+        }
+    }
+
+    T* keys;
+    std::size_t count;
+    std::size_t levels;
+};
+
+#endif // FROZEN_SET_H
@@ -0,0 +1,364 @@
+#ifndef INDEXED_AVL_H
+#define INDEXED_AVL_H
+
+#include <iostream>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// AVL node addressed by 32-bit pool indices instead of pointers, with index 0
+// as the null child. With an int key and a balance-factor byte it is 16 bytes.
+// Packing the balance into spare index bits would reach 12, but masking the
+// child index makes GCC turn the search step into a cmov (see AVL::search),
+// which made lookups about three times slower.
+template<typename T>
+struct IndexedNodeALV {
+    T key;
+    uint32_t left;
+    uint32_t right;
+    signed char balance;
+
+    IndexedNodeALV(const T& k) : key(k), left(0), right(0), balance(0) {}
+};
+
+// Chunked node pool. Chunks never move once allocated, so indices and
+// references stay valid as the pool grows, and nothing inside it depends on
+// where it sits in memory.
+template<typename Node>
+class IndexPool {
+public:
+    static constexpr int CHUNK_BITS = 16;
+    static constexpr uint32_t CHUNK_SIZE = uint32_t(1) << CHUNK_BITS;
+    static constexpr uint32_t MAX_INDEX = UINT32_MAX;
+
+    // Slot 0 is reserved so that index 0 can mean "no node".
+    IndexPool() : freeList(0), used(1) {}
+
+    IndexPool(const IndexPool&) = delete;
+    IndexPool& operator=(const IndexPool&) = delete;
+
+    Node& operator[](uint32_t index) {
+        return reinterpret_cast<Node&>(chunks[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)]);
+    }
+
+    const Node& operator[](uint32_t index) const {
+        return reinterpret_cast<const Node&>(chunks[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)]);
+    }
+
+    uint32_t allocate() {
+        if (freeList) {
+            uint32_t index = freeList;
+            freeList = slot(index).next;
+            return index;
+        }
+        if (used == MAX_INDEX) {
+            throw std::length_error("IndexPool: out of 32-bit indices");
+        }
+        if ((used >> CHUNK_BITS) == chunks.size()) {
+            chunks.emplace_back(new Slot[CHUNK_SIZE]);
+        }
+        return used++;
+    }
+
+    void deallocate(uint32_t index) {
+        slot(index).next = freeList;
+        freeList = index;
+    }
+
+    void release() {
+        chunks.clear();
+        freeList = 0;
+        used = 1;
+    }
+
+private:
+    union Slot {
+        uint32_t next;
+        alignas(Node) unsigned char storage[sizeof(Node)];
+    };
+
+    Slot& slot(uint32_t index) {
+        return chunks[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)];
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> chunks;
+    uint32_t freeList;
+    uint32_t used;
+};
+
+// AVL tree whose nodes live in an IndexPool. Insert and delete retrace with
+// balance factors, like CompactAVL.
+template<typename T>
+class IndexedAVL {
+public:
+    static constexpr int MAX_HEIGHT = 64;
+
+    IndexedAVL() : root(0) {}
+
+    IndexedAVL(const IndexedAVL&) = delete;
+    IndexedAVL& operator=(const IndexedAVL&) = delete;
+
+    ~IndexedAVL() {
+        clear();
+    }
+
+    static constexpr std::size_t nodeSize() {
+        return sizeof(IndexedNodeALV<T>);
+    }
+
+    void clear() {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            destroyTree(root);
+        }
+        pool.release();
+        root = 0;
+    }
+
+    void insert(const T& key) {
+        uint32_t path[MAX_HEIGHT];
+        bool wentLeft[MAX_HEIGHT];
+        int depth = 0;
+        uint32_t current = root;
+
+        while (current) {
+            IndexedNodeALV<T>& node = pool[current];
+            if (key < node.key) {
+                path[depth] = current;
+                wentLeft[depth++] = true;
+                current = node.left;
+            } else if (key > node.key) {
+                path[depth] = current;
+                wentLeft[depth++] = false;
+                current = node.right;
+            } else {
+                return;
+            }
+        }
+
+        uint32_t child = pool.allocate();
+        new (&pool[child]) IndexedNodeALV<T>(key);
+        if (depth == 0) {
+            root = child;
+            return;
+        }
+        setChild(path[depth - 1], wentLeft[depth - 1], child);
+
+        // Each step up, the side we came from has grown by one level.
+        while (depth > 0) {
+            uint32_t index = path[--depth];
+            int balance = balanceOf(index) + (wentLeft[depth] ? 1 : -1);
+            if (balance == 0) {
+                setBalance(index, 0);
+                return;
+            }
+            if (balance == 2 || balance == -2) {
+                // A rotation after an insert restores the subtree's previous height.
+                bool shrunk;
+                replaceChild(path, wentLeft, depth, rebalance(index, balance, shrunk));
+                return;
+            }
+            setBalance(index, balance);
+        }
+    }
+
+    void deleteNode(const T& key) {
+        uint32_t path[MAX_HEIGHT];
+        bool wentLeft[MAX_HEIGHT];
+        int depth = 0;
+        uint32_t target = root;
+
+        while (true) {
+            if (!target) {
+                return;
+            }
+            IndexedNodeALV<T>& node = pool[target];
+            if (key < node.key) {
+                path[depth] = target;
+                wentLeft[depth++] = true;
+                target = node.left;
+            } else if (key > node.key) {
+                path[depth] = target;
+                wentLeft[depth++] = false;
+                target = node.right;
+            } else {
+                break;
+            }
+        }
+
+        uint32_t victim = target;
+        if (leftOf(target) && rightOf(target)) {
+            path[depth] = target;
+            wentLeft[depth++] = false;
+            victim = rightOf(target);
+            while (leftOf(victim)) {
+                path[depth] = victim;
+                wentLeft[depth++] = true;
+                victim = leftOf(victim);
+            }
+            pool[target].key = pool[victim].key;
+        }
+
+        uint32_t replacement = leftOf(victim) ? leftOf(victim) : rightOf(victim);
+        replaceChild(path, wentLeft, depth, replacement);
+        pool[victim].~IndexedNodeALV<T>();
+        pool.deallocate(victim);
+
+        // Each step up, the side we came from has shrunk by one level.
+        while (depth > 0) {
+            uint32_t index = path[--depth];
+            int balance = balanceOf(index) + (wentLeft[depth] ? -1 : 1);
+            if (balance == 1 || balance == -1) {
+                setBalance(index, balance);
+                return;
+            }
+            if (balance == 0) {
+                setBalance(index, 0);
+                continue;
+            }
+            bool shrunk;
+            replaceChild(path, wentLeft, depth, rebalance(index, balance, shrunk));
+            if (!shrunk) {
+                return;
+            }
+        }
+    }
+
+    // Same descent as AVL::search.
+    bool search(const T& key) const {
+        uint32_t current = root;
+        uint32_t candidate = 0;
+        while (current) {
+            const IndexedNodeALV<T>& node = pool[current];
+            if (node.key < key) {
+                current = node.right;
+            } else {
+                candidate = current;
+                current = node.left;
+            }
+        }
+        return candidate && !(key < pool[candidate].key);
+    }
+
+    void printInOrder() {
+        printInOrder(root);
+        std::cout << std::endl;
+    }
+
+private:
+    uint32_t leftOf(uint32_t index) const {
+        return pool[index].left;
+    }
+
+    uint32_t rightOf(uint32_t index) const {
+        return pool[index].right;
+    }
+
+    int balanceOf(uint32_t index) const {
+        return pool[index].balance;
+    }
+
+    void setBalance(uint32_t index, int balance) {
+        pool[index].balance = static_cast<signed char>(balance);
+    }
+
+    void setChild(uint32_t parent, bool left, uint32_t child) {
+        if (left) {
+            pool[parent].left = child;
+        } else {
+            pool[parent].right = child;
+        }
+    }
+
+    // Points whatever held path[depth] (its parent, or the root) at child.
+    void replaceChild(const uint32_t* path, const bool* wentLeft, int depth, uint32_t child) {
+        if (depth == 0) {
+            root = child;
+        } else {
+            setChild(path[depth - 1], wentLeft[depth - 1], child);
+        }
+    }
+
+    void setLeft(uint32_t index, uint32_t child) {
+        setChild(index, true, child);
+    }
+
+    void setRight(uint32_t index, uint32_t child) {
+        setChild(index, false, child);
+    }
+
+    // Rebalances a node whose balance factor would be +2 or -2 and returns
+    // the subtree's new root; shrunk tells a delete whether the subtree lost
+    // a level.
+    uint32_t rebalance(uint32_t index, int balance, bool& shrunk) {
+        if (balance > 0) {
+            uint32_t child = leftOf(index);
+            int childBalance = balanceOf(child);
+            if (childBalance >= 0) {
+                setLeft(index, rightOf(child));
+                setRight(child, index);
+                setBalance(index, childBalance == 0 ? 1 : 0);
+                setBalance(child, childBalance == 0 ? -1 : 0);
+                shrunk = childBalance != 0;
+                return child;
+            }
+            uint32_t grandchild = rightOf(child);
+            int grandchildBalance = balanceOf(grandchild);
+            setRight(child, leftOf(grandchild));
+            setLeft(index, rightOf(grandchild));
+            setLeft(grandchild, child);
+            setRight(grandchild, index);
+            setBalance(child, grandchildBalance < 0 ? 1 : 0);
+            setBalance(index, grandchildBalance > 0 ? -1 : 0);
+            setBalance(grandchild, 0);
+            shrunk = true;
+            return grandchild;
+        }
+
+        uint32_t child = rightOf(index);
+        int childBalance = balanceOf(child);
+        if (childBalance <= 0) {
+            setRight(index, leftOf(child));
+            setLeft(child, index);
+            setBalance(index, childBalance == 0 ? -1 : 0);
+            setBalance(child, childBalance == 0 ? 1 : 0);
+            shrunk = childBalance != 0;
+            return child;
+        }
+        uint32_t grandchild = leftOf(child);
+        int grandchildBalance = balanceOf(grandchild);
+        setLeft(child, rightOf(grandchild));
+        setRight(index, leftOf(grandchild));
+        setRight(grandchild, child);
+        setLeft(grandchild, index);
+        setBalance(child, grandchildBalance > 0 ? -1 : 0);
+        setBalance(index, grandchildBalance < 0 ? 1 : 0);
+        setBalance(grandchild, 0);
+        shrunk = true;
+        return grandchild;
+    }
+
+    void destroyTree(uint32_t index) {
+        if (index) {
+            destroyTree(leftOf(index));
+            destroyTree(rightOf(index));
+            pool[index].~IndexedNodeALV<T>();
+        }
+    }
+
+    void printInOrder(uint32_t index) {
+        if (index) {
+            printInOrder(leftOf(index));
+            std::cout << pool[index].key << " ";
+            printInOrder(rightOf(index));
+        }
+    }
+
+    IndexPool<IndexedNodeALV<T>> pool;
+    uint32_t root;
+};
+
+#endif // INDEXED_AVL_H
@@ -0,0 +1,301 @@
+#ifndef LOCK_FREE_SKIP_LIST_H
+#define LOCK_FREE_SKIP_LIST_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <random>
+#include <thread>
+#include "Epoch.h"
+
+// Lock-free ordered set after Fraser ("Practical lock-freedom", 2004) and
+// Herlihy and Shavit (The Art of Multiprocessor Programming, ch. 14). A node
+// is in the set while its level-0 link is unmarked; remove marks the links
+// of its tower from the top down, and whichever thread next walks past a
+// marked link snips the node out of that level. search never writes.
+//
+// Unlinked nodes go to Epoch. A node is retired by the later of its remover
+// and its inserter, since the inserter may still be linking upper levels of
+// a node that has already been removed and snipped from the levels below.
+//
+// Each node is one allocation holding the key with its tower of links right
+// after it, sized up to a power of two and aligned to that size (at most a
+// cache line). A tower that fits in a line then never straddles two, and the
+// bottom levels a search touches last share the key's line. Padding every
+// node to a whole line would double the footprint of the many short towers.
+template<typename T>
+class LockFreeSkipList {
+public:
+    static constexpr int MAX_HEIGHT = 24;
+    static constexpr std::size_t CACHE_LINE = 64;
+
+    LockFreeSkipList() : head(allocate(T{}, MAX_HEIGHT)) {}
+
+    LockFreeSkipList(const LockFreeSkipList&) = delete;
+    LockFreeSkipList& operator=(const LockFreeSkipList&) = delete;
+
+    // No other thread may still be using the list.
+    ~LockFreeSkipList() {
+        Node* node = head;
+        while (node) {
+            Node* next = pointer(node->tower()[0].load(std::memory_order_relaxed));
+            reclaim(node);
+            node = next;
+        }
+    }
+
+    // Returns whether key was added; keys already present are left alone.
+    bool insert(const T& key) {
+        Epoch::Guard guard;
+        Node* preds[MAX_HEIGHT];
+        Node* succs[MAX_HEIGHT];
+        Node* node = nullptr;
+        while (true) {
+            if (find(key, preds, succs)) {
+                if (node) {
+                    reclaim(node);
+                }
+                return false;
+            }
+            if (!node) {
+                node = allocate(key, randomHeight());
+            }
+            for (int level = 0; level < node->height; ++level) {
+                node->tower()[level].store(link(succs[level]), std::memory_order_relaxed);
+            }
+            std::uintptr_t expected = link(succs[0]);
+            if (preds[0]->tower()[0].compare_exchange_strong(expected, link(node), std::memory_order_release, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+
+        for (int level = 1; level < node->height; ++level) {
+            if (!linkLevel(node, level, preds, succs)) {
+                break;
+            }
+        }
+        if (marked(node->tower()[0].load(std::memory_order_acquire))) {
+            // Removed while being linked: make sure no level still reaches it.
+            find(key, preds, succs);
+        }
+        releaseOwner(node);
+        return true;
+    }
+
+    bool remove(const T& key) {
+        Epoch::Guard guard;
+        Node* preds[MAX_HEIGHT];
+        Node* succs[MAX_HEIGHT];
+        if (!find(key, preds, succs)) {
+            return false;
+        }
+        Node* victim = succs[0];
+        for (int level = victim->height - 1; level > 0; --level) {
+            std::uintptr_t next = victim->tower()[level].load(std::memory_order_relaxed);
+            while (!marked(next) && !victim->tower()[level].compare_exchange_weak(next, next | MARK, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            }
+        }
+        std::uintptr_t next = victim->tower()[0].load(std::memory_order_relaxed);
+        while (!marked(next)) {
+            if (victim->tower()[0].compare_exchange_weak(next, next | MARK, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                find(key, preds, succs);
+                releaseOwner(victim);
+                return true;
+            }
+        }
+        // Another remove marked it first.
+        return false;
+    }
+
+    bool search(const T& key) const {
+        Epoch::Guard guard;
+        Node* node = lowerBound(key);
+        return node && !(key < node->key);
+    }
+
+    // Calls visit(key) for every key in ascending order. Keys inserted or
+    // removed while the walk runs may or may not be seen.
+    template<typename Visit>
+    void forEach(Visit&& visit) const {
+        Epoch::Guard guard;
+        visitFrom(pointer(head->tower()[0].load(std::memory_order_acquire)), nullptr, visit);
+    }
+
+    // Same, for the keys in [lo, hi].
+    template<typename Visit>
+    void forEachInRange(const T& lo, const T& hi, Visit&& visit) const {
+        if (hi < lo) {
+            return;
+        }
+        Epoch::Guard guard;
+        visitFrom(lowerBound(lo), &hi, visit);
+    }
+
+private:
+    using Link = std::atomic<std::uintptr_t>;
+
+    static constexpr std::uintptr_t MARK = 1;
+
+    struct alignas(T) alignas(Link) Node {
+        T key;
+        std::uint8_t height;
+        // The inserter and, once there is one, the remover; the last to
+        // finish with the node retires it.
+        std::atomic<std::uint8_t> owners;
+
+        Node(const T& k, int h) : key(k), height(static_cast<std::uint8_t>(h)), owners(2) {}
+
+        Link* tower() {
+            return reinterpret_cast<Link*>(this + 1);
+        }
+    };
+
+    enum Result { NOT_FOUND, FOUND, RETRY };
+
+    static Node* pointer(std::uintptr_t value) {
+        return reinterpret_cast<Node*>(value & ~MARK);
+    }
+
+    static bool marked(std::uintptr_t value) {
+        return value & MARK;
+    }
+
+    static std::uintptr_t link(Node* node) {
+        return reinterpret_cast<std::uintptr_t>(node);
+    }
+
+    static std::size_t allocationSize(int height) {
+        return std::bit_ceil(sizeof(Node) + height * sizeof(Link));
+    }
+
+    static std::align_val_t alignment(int height) {
+        return std::align_val_t(std::min(allocationSize(height), CACHE_LINE));
+    }
+
+    static Node* allocate(const T& key, int height) {
+        void* memory = ::operator new(allocationSize(height), alignment(height));
+        Node* node = new (memory) Node(key, height);
+        for (int level = 0; level < height; ++level) {
+            new (node->tower() + level) Link(0);
+        }
+        return node;
+    }
+
+    static void reclaim(void* memory) {
+        Node* node = static_cast<Node*>(memory);
+        int height = node->height;
+        node->~Node();
+        ::operator delete(memory, alignment(height));
+    }
+
+    static void releaseOwner(Node* node) {
+        if (node->owners.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            Epoch::retire(node, reclaim);
+        }
+    }
+
+    // Geometric with p = 1/2.
+    static int randomHeight() {
+        thread_local std::mt19937_64 rng(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        return std::min(MAX_HEIGHT, std::countr_zero(rng() | (std::uint64_t(1) << 63)) + 1);
+    }
+
+    // Links node into level after its lower levels. Returns false, leaving
+    // the levels above unlinked, once remove has marked the node.
+    bool linkLevel(Node* node, int level, Node** preds, Node** succs) {
+        Link& own = node->tower()[level];
+        while (true) {
+            std::uintptr_t next = own.load(std::memory_order_acquire);
+            if (marked(next)) {
+                return false;
+            }
+            // Mark is the only change anyone else makes to the link.
+            if (pointer(next) != succs[level] &&
+                !own.compare_exchange_strong(next, link(succs[level]), std::memory_order_acq_rel, std::memory_order_acquire)) {
+                return false;
+            }
+            std::uintptr_t expected = link(succs[level]);
+            if (preds[level]->tower()[level].compare_exchange_strong(expected, link(node), std::memory_order_release, std::memory_order_relaxed)) {
+                return true;
+            }
+            find(node->key, preds, succs);
+        }
+    }
+
+    // Fills preds and succs with the last node before key and the first node
+    // at or after it on every level, snipping marked nodes on the way.
+    bool find(const T& key, Node** preds, Node** succs) {
+        while (true) {
+            Result result = attemptFind(key, preds, succs);
+            if (result != RETRY) {
+                return result == FOUND;
+            }
+        }
+    }
+
+    Result attemptFind(const T& key, Node** preds, Node** succs) {
+        Node* pred = head;
+        for (int level = MAX_HEIGHT - 1; level >= 0; --level) {
+            Node* curr = pointer(pred->tower()[level].load(std::memory_order_acquire));
+            while (curr) {
+                std::uintptr_t next = curr->tower()[level].load(std::memory_order_acquire);
+                if (marked(next)) {
+                    std::uintptr_t expected = link(curr);
+                    if (!pred->tower()[level].compare_exchange_strong(expected, next & ~MARK, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                        return RETRY;
+                    }
+                    curr = pointer(next);
+                } else if (curr->key < key) {
+                    pred = curr;
+                    curr = pointer(next);
+                } else {
+                    break;
+                }
+            }
+            preds[level] = pred;
+            succs[level] = curr;
+        }
+        return succs[0] && !(key < succs[0]->key) ? FOUND : NOT_FOUND;
+    }
+
+    // First unmarked node at or after key, stepping over marked ones
+    // without snipping them.
+    Node* lowerBound(const T& key) const {
+        Node* pred = head;
+        Node* curr = nullptr;
+        for (int level = MAX_HEIGHT - 1; level >= 0; --level) {
+            curr = pointer(pred->tower()[level].load(std::memory_order_acquire));
+            while (curr) {
+                std::uintptr_t next = curr->tower()[level].load(std::memory_order_acquire);
+                if (marked(next)) {
+                    curr = pointer(next);
+                } else if (curr->key < key) {
+                    pred = curr;
+                    curr = pointer(next);
+                } else {
+                    break;
+                }
+            }
+        }
+        return curr;
+    }
+
+    template<typename Visit>
+    static void visitFrom(Node* node, const T* hi, Visit& visit) {
+        while (node && !(hi && *hi < node->key)) {
+            std::uintptr_t next = node->tower()[0].load(std::memory_order_acquire);
+            if (!marked(next)) {
+                visit(node->key);
+            }
+            node = pointer(next);
+        }
+    }
+
+    Node* head;
+};
+
+#endif // LOCK_FREE_SKIP_LIST_H
@@ -0,0 +1,123 @@
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Slab arena for tree nodes. Storage is carved out of large chunks, freed
+// nodes go onto an intrusive free list and are reused by later allocations,
+// and memory is only handed back to the system when the arena is released.
+template<typename Node>
+class NodeArena {
+public:
+    static constexpr bool releasesInBulk = true;
+
+    NodeArena() : freeList(nullptr), cursor(nullptr), limit(nullptr), nextChunkSize(MIN_CHUNK) {}
+
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    Node* allocate() {
+        if (freeList) {
+            Slot* slot = freeList;
+            freeList = slot->next;
+            return reinterpret_cast<Node*>(slot);
+        }
+        if (cursor == limit) {
+            grow(nextChunkSize);
+            if (nextChunkSize < MAX_CHUNK) nextChunkSize *= 2;
+        }
+        return reinterpret_cast<Node*>(cursor++);
+    }
+
+    // Returns storage for count nodes laid out back to back.
+    Node* allocateBlock(std::size_t count) {
+        if (static_cast<std::size_t>(limit - cursor) >= count) {
+            Slot* block = cursor;
+            cursor += count;
+            return reinterpret_cast<Node*>(block);
+        }
+        chunks.emplace_back(new Slot[count]);
+        return reinterpret_cast<Node*>(chunks.back().get());
+    }
+
+    void deallocate(Node* node) {
+        Slot* slot = reinterpret_cast<Slot*>(node);
+        slot->next = freeList;
+        freeList = slot;
+    }
+
+    // Takes over another arena's chunks and free list so that nodes it handed
+    // out can be freed through this one. The other arena is left empty.
+    void adopt(NodeArena& other) {
+        for (auto& chunk : other.chunks) {
+            chunks.push_back(std::move(chunk));
+        }
+        if (other.freeList) {
+            Slot* tail = other.freeList;
+            while (tail->next) {
+                tail = tail->next;
+            }
+            tail->next = freeList;
+            freeList = other.freeList;
+        }
+        if (cursor == limit) {
+            cursor = other.cursor;
+            limit = other.limit;
+        }
+        other.chunks.clear();
+        other.freeList = nullptr;
+        other.cursor = other.limit = nullptr;
+    }
+
+    // Drops every node at once; callers must have run any destructors already.
+    void release() {
+        chunks.clear();
+        freeList = nullptr;
+        cursor = limit = nullptr;
+        nextChunkSize = MIN_CHUNK;
+    }
+
+private:
+    union Slot {
+        Slot* next;
+        alignas(Node) unsigned char storage[sizeof(Node)];
+    };
+
+    static constexpr std::size_t MIN_CHUNK = 64;
+    static constexpr std::size_t MAX_CHUNK = std::size_t(1) << 16;
+
+    void grow(std::size_t count) {
+        chunks.emplace_back(new Slot[count]);
+        cursor = chunks.back().get();
+        limit = cursor + count;
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> chunks;
+    Slot* freeList;
+    Slot* cursor;
+    Slot* limit;
+    std::size_t nextChunkSize;
+};
+
+// One global new/delete per node, the behaviour of the original trees.
+template<typename Node>
+class HeapNodeAllocator {
+public:
+    static constexpr bool releasesInBulk = false;
+
+    Node* allocate() {
+        return static_cast<Node*>(::operator new(sizeof(Node)));
+    }
+
+    void deallocate(Node* node) {
+        ::operator delete(node);
+    }
+
+    void adopt(HeapNodeAllocator&) {}
+
+    void release() {}
+};
+
+#endif // NODE_ARENA_H
@@ -0,0 +1,309 @@
+#ifndef PERSISTENT_AVL_H
+#define PERSISTENT_AVL_H
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <mutex>
+#include <vector>
+#include "Epoch.h"
+
+// Immutable once published: a new version of the tree shares every node it
+// does not change with the versions before it.
+template<typename T>
+class PersistentNodeALV {
+public:
+    T key;
+    int height;
+    const PersistentNodeALV* left;
+    const PersistentNodeALV* right;
+
+    PersistentNodeALV(const T& k, const PersistentNodeALV* l, const PersistentNodeALV* r, int h)
+        : key(k), height(h), left(l), right(r) {}
+};
+
+// Path-copying AVL tree. insert and deleteNode build a new version that
+// copies only the nodes on the root-to-leaf path (plus the few a rotation
+// touches) and publish it with one atomic store of the root. Readers never
+// lock: they pin an Epoch guard and read whatever version the root held, and
+// nodes that dropped out of the newest version are retired to the epoch
+// collector, which frees them once no pinned reader can still hold them.
+// Writers are serialized by a mutex.
+template<typename T>
+class PersistentAVL {
+public:
+    using Node = PersistentNodeALV<T>;
+
+    static constexpr int MAX_HEIGHT = 64;
+
+    // A consistent version of the tree that stays readable for as long as
+    // the snapshot lives. It pins the calling thread's epoch, so it must be
+    // destroyed on the thread that took it, and while it lives no node
+    // retired since can be freed.
+    class Snapshot {
+    public:
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+
+        bool search(const T& key) const {
+            return PersistentAVL::search(top, key);
+        }
+
+        // Calls visit(key) for every key in ascending order.
+        template<typename Visit>
+        void forEach(Visit&& visit) const {
+            const Node* path[MAX_HEIGHT];
+            int depth = 0;
+            const Node* node = top;
+            while (node || depth > 0) {
+                while (node) {
+                    path[depth++] = node;
+                    node = node->left;
+                }
+                node = path[--depth];
+                visit(node->key);
+                node = node->right;
+            }
+        }
+
+    private:
+        friend class PersistentAVL;
+
+        // The guard is a member declared before top, so the thread is pinned
+        // before the root is read.
+        explicit Snapshot(const std::atomic<const Node*>& root) : top(root.load(std::memory_order_acquire)) {}
+
+        Epoch::Guard guard;
+        const Node* top;
+    };
+
+    PersistentAVL() : root(nullptr) {}
+
+    PersistentAVL(const PersistentAVL&) = delete;
+    PersistentAVL& operator=(const PersistentAVL&) = delete;
+
+    // Frees the current version; no reader or snapshot may still be using it.
+    ~PersistentAVL() {
+        destroyTree(root.load(std::memory_order_relaxed));
+    }
+
+    Snapshot snapshot() const {
+        return Snapshot(root);
+    }
+
+    bool search(const T& key) const {
+        Epoch::Guard guard;
+        return search(root.load(std::memory_order_acquire), key);
+    }
+
+    void insert(const T& key) {
+        std::lock_guard<std::mutex> lock(writer);
+        const Node* current = root.load(std::memory_order_relaxed);
+        const Node* updated = insert(current, key);
+        if (updated != current) {
+            publish(updated);
+        }
+    }
+
+    void deleteNode(const T& key) {
+        std::lock_guard<std::mutex> lock(writer);
+        const Node* current = root.load(std::memory_order_relaxed);
+        const Node* updated = remove(current, key);
+        if (updated != current) {
+            publish(updated);
+        }
+    }
+
+    // Replaces the contents with the keys of an ascending range in O(n).
+    // Duplicates are skipped.
+    template<typename ForwardIt>
+    void build_from_sorted(ForwardIt first, ForwardIt last) {
+        std::lock_guard<std::mutex> lock(writer);
+        std::vector<T> keys;
+        keys.reserve(std::distance(first, last));
+        for (; first != last; ++first) {
+            if (keys.empty() || keys.back() < *first) {
+                keys.push_back(*first);
+            }
+        }
+        const Node* previous = root.load(std::memory_order_relaxed);
+        root.store(linkBalanced(keys, 0, keys.size()), std::memory_order_release);
+        retireTree(previous);
+    }
+
+    void printInOrder() {
+        snapshot().forEach([](const T& key) { std::cout << key << " "; });
+        std::cout << std::endl;
+    }
+
+private:
+    // Same descent as AVL::search.
+    static bool search(const Node* node, const T& key) {
+        const Node* candidate = nullptr;
+        while (node) {
+            if (node->key < key) {
+                node = node->right;
+            } else {
+                candidate = node;
+                node = node->left;
+            }
+        }
+        return candidate && !(key < candidate->key);
+    }
+
+    static int getHeight(const Node* node) {
+        return node ? node->height : 0;
+    }
+
+    const Node* create(const Node* left, const T& key, const Node* right) {
+        const Node* node = new Node(key, left, right, 1 + std::max(getHeight(left), getHeight(right)));
+        created.push_back(node);
+        return node;
+    }
+
+    // Builds a node over two subtrees whose heights differ by at most two,
+    // rotating by creating new nodes. The nodes a rotation takes apart are
+    // discarded rather than changed, since older versions may share them.
+    const Node* balance(const Node* left, const T& key, const Node* right) {
+        int leftHeight = getHeight(left);
+        int rightHeight = getHeight(right);
+        if (leftHeight > rightHeight + 1) {
+            garbage.push_back(left);
+            if (getHeight(left->left) >= getHeight(left->right)) {
+                return create(left->left, left->key, create(left->right, key, right));
+            }
+            const Node* middle = left->right;
+            garbage.push_back(middle);
+            return create(create(left->left, left->key, middle->left), middle->key, create(middle->right, key, right));
+        }
+        if (rightHeight > leftHeight + 1) {
+            garbage.push_back(right);
+            if (getHeight(right->right) >= getHeight(right->left)) {
+                return create(create(left, key, right->left), right->key, right->right);
+            }
+            const Node* middle = right->left;
+            garbage.push_back(middle);
+            return create(create(left, key, middle->left), middle->key, create(middle->right, right->key, right->right));
+        }
+        return create(left, key, right);
+    }
+
+    // Both return node itself when nothing changed.
+    const Node* insert(const Node* node, const T& key) {
+        if (!node) {
+            return create(nullptr, key, nullptr);
+        }
+        if (key < node->key) {
+            const Node* left = insert(node->left, key);
+            if (left == node->left) {
+                return node;
+            }
+            garbage.push_back(node);
+            return balance(left, node->key, node->right);
+        }
+        if (node->key < key) {
+            const Node* right = insert(node->right, key);
+            if (right == node->right) {
+                return node;
+            }
+            garbage.push_back(node);
+            return balance(node->left, node->key, right);
+        }
+        return node;
+    }
+
+    const Node* remove(const Node* node, const T& key) {
+        if (!node) {
+            return nullptr;
+        }
+        if (key < node->key) {
+            const Node* left = remove(node->left, key);
+            if (left == node->left) {
+                return node;
+            }
+            garbage.push_back(node);
+            return balance(left, node->key, node->right);
+        }
+        if (node->key < key) {
+            const Node* right = remove(node->right, key);
+            if (right == node->right) {
+                return node;
+            }
+            garbage.push_back(node);
+            return balance(node->left, node->key, right);
+        }
+
+        garbage.push_back(node);
+        if (!node->left) {
+            return node->right;
+        }
+        if (!node->right) {
+            return node->left;
+        }
+        const Node* successor = node->right;
+        while (successor->left) {
+            successor = successor->left;
+        }
+        return balance(node->left, successor->key, removeMin(node->right));
+    }
+
+    const Node* removeMin(const Node* node) {
+        garbage.push_back(node);
+        if (!node->left) {
+            return node->right;
+        }
+        return balance(removeMin(node->left), node->key, node->right);
+    }
+
+    // Makes the new version visible, then frees what this update discarded:
+    // nodes it created itself were never published and go at once, the rest
+    // wait for the readers that may still hold the previous version.
+    void publish(const Node* updated) {
+        root.store(updated, std::memory_order_release);
+        std::sort(created.begin(), created.end());
+        for (const Node* node : garbage) {
+            if (std::binary_search(created.begin(), created.end(), node)) {
+                delete node;
+            } else {
+                Epoch::retire(node);
+            }
+        }
+        created.clear();
+        garbage.clear();
+    }
+
+    const Node* linkBalanced(const std::vector<T>& keys, std::size_t lo, std::size_t hi) {
+        if (lo == hi) {
+            return nullptr;
+        }
+        std::size_t mid = lo + (hi - lo) / 2;
+        const Node* left = linkBalanced(keys, lo, mid);
+        const Node* right = linkBalanced(keys, mid + 1, hi);
+        return new Node(keys[mid], left, right, 1 + std::max(getHeight(left), getHeight(right)));
+    }
+
+    static void retireTree(const Node* node) {
+        if (node) {
+            retireTree(node->left);
+            retireTree(node->right);
+            Epoch::retire(node);
+        }
+    }
+
+    static void destroyTree(const Node* node) {
+        if (node) {
+            destroyTree(node->left);
+            destroyTree(node->right);
+            delete node;
+        }
+    }
+
+    std::atomic<const Node*> root;
+    std::mutex writer;
+    std::vector<const Node*> created;
+    std::vector<const Node*> garbage;
+};
+
+#endif // PERSISTENT_AVL_H
@@ -1,35 +1,306 @@
+#ifndef RED_BLACK_TREE_H
+#define RED_BLACK_TREE_H
+
 #include <iostream>
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
 using namespace std;
 
-template<typename T>
-struct Node {
+// Subtree size kept by order-statistic trees; an empty base otherwise, so
+// plain trees pay nothing for it.
+template<bool Sized>
+struct NodeSize {};
+
+template<>
+struct NodeSize<true> {
+    size_t size = 1;
+};
+
+template<typename T, bool Sized = false>
+struct Node : NodeSize<Sized> {
     T data;
     char color;
+    // Set when the node lives in a bulk-loaded block rather than in an
+    // allocation of its own; it fits in the padding after color.
+    bool inBlock;
     Node* parent;
     Node* left;
     Node* right;
 
-    Node(T value) : data(value), color('R'), parent(nullptr), left(nullptr), right(nullptr) {}
+    Node(T value) : data(value), color('R'), inBlock(false), parent(nullptr), left(nullptr), right(nullptr) {}
 };
 
-template<typename T>
+// With OrderStatistics every node also stores its subtree size, which enables
+// select, rank and count in O(log n) at the cost of a word per node and a size
+// update per rotation.
+template<typename T, bool OrderStatistics = false>
 class RBT {
+public:
+    using TreeNode = Node<T, OrderStatistics>;
+
 private:
-    Node<T>* root;
+    // Contiguous storage handed out by a bulk load. Its nodes are never given
+    // back to the resource one by one: removed ones are recycled through the
+    // tree's free list and the block is released as a whole, once no tree
+    // that split from this one still holds it.
+    struct NodeBlock {
+        TreeNode* nodes;
+        size_t count;
+        pmr::polymorphic_allocator<TreeNode> alloc;
+
+        NodeBlock(TreeNode* nodes, size_t count, pmr::polymorphic_allocator<TreeNode> alloc) : nodes(nodes), count(count), alloc(alloc) {}
+        NodeBlock(const NodeBlock&) = delete;
+        NodeBlock& operator=(const NodeBlock&) = delete;
+
+        ~NodeBlock() {
+            alloc.deallocate(nodes, count);
+        }
+
+    };
+
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    TreeNode* root;
+    pmr::polymorphic_allocator<TreeNode> alloc;
+    // Sorted by address, so merging two trees' blocks is linear.
+    vector<shared_ptr<NodeBlock>> blocks;
+    // Only ever holds nodes of the blocks above.
+    FreeNode* freeNodes;
+    // The largest node, or nullptr when it is not currently known.
+    TreeNode* rightmost;
 
 public:
-    RBT() : root(nullptr) {}
+    explicit RBT(pmr::memory_resource* resource = pmr::get_default_resource()) : root(nullptr), alloc(resource), freeNodes(nullptr), rightmost(nullptr) {}
+
+    template<typename ForwardIt>
+    RBT(ForwardIt first, ForwardIt last, bool deduplicate = false, pmr::memory_resource* resource = pmr::get_default_resource())
+        : root(nullptr), alloc(resource), freeNodes(nullptr), rightmost(nullptr) {
+        build_from_sorted(first, last, deduplicate);
+    }
+
+    RBT(const RBT&) = delete;
+    RBT& operator=(const RBT&) = delete;
+
+    RBT(RBT&& other) noexcept : root(other.root), alloc(other.alloc), blocks(std::move(other.blocks)), freeNodes(other.freeNodes), rightmost(other.rightmost) {
+        other.root = nullptr;
+        other.freeNodes = nullptr;
+        other.rightmost = nullptr;
+    }
+
+    ~RBT() {
+        // A monotonic buffer ignores deallocation, so there is nothing to walk unless values need destructing.
+        if (is_trivially_destructible<T>::value && dynamic_cast<pmr::monotonic_buffer_resource*>(alloc.resource())) {
+            return;
+        }
+        destroyTree(root);
+    }
+
+    pmr::memory_resource* resource() const {
+        return alloc.resource();
+    }
+
+    void clear() {
+        destroyTree(root);
+        root = nullptr;
+        rightmost = nullptr;
+        releaseBlocks();
+    }
+
+    // Replaces the contents with an ascending range in O(n). All nodes come
+    // from a single allocation; the tree is perfectly balanced with only its
+    // deepest incomplete level coloured red.
+    template<typename ForwardIt>
+    void build_from_sorted(ForwardIt first, ForwardIt last, bool deduplicate = false) {
+        clear();
+        size_t capacity = distance(first, last);
+        if (capacity == 0) {
+            return;
+        }
+
+        TreeNode* block = alloc.allocate(capacity);
+        auto owner = make_shared<NodeBlock>(block, capacity, alloc);
+        blocks.insert(upper_bound(blocks.begin(), blocks.end(), owner), owner);
+
+        size_t count = 0;
+        for (; first != last; ++first) {
+            if (!deduplicate || count == 0 || block[count - 1].data < *first) {
+                new (&block[count]) TreeNode(*first);
+                block[count++].inBlock = true;
+            }
+        }
+        for (size_t i = capacity; i > count; --i) {
+            recycleNode(&block[i - 1]);
+        }
+
+        int levels = 0;
+        while ((size_t(1) << levels) - 1 < count) {
+            ++levels;
+        }
+        int redDepth = (size_t(1) << levels) - 1 == count ? -1 : levels - 1;
+        root = linkBalanced(block, 0, count, nullptr, 0, redDepth);
+        rightmost = count > 0 ? &block[count - 1] : nullptr;
+    }
+
+    // Moves the values below key into the first tree and the rest into the
+    // second in O(log n), leaving this tree empty.
+    pair<RBT, RBT> split(const T& key) {
+        TreeNode* lower;
+        TreeNode* upper;
+        int lowerBlackHeight;
+        int upperBlackHeight;
+        splitTree(root, blackHeight(root), key, lower, lowerBlackHeight, upper, upperBlackHeight);
+        root = nullptr;
+        rightmost = nullptr;
+
+        pair<RBT, RBT> halves{RBT(resource()), RBT(resource())};
+        halves.first.root = lower;
+        halves.first.blocks = blocks;
+        halves.first.freeNodes = freeNodes;
+        halves.second.root = upper;
+        halves.second.blocks = std::move(blocks);
+        releaseBlocks();
+        return halves;
+    }
+
+    // Concatenates two trees around pivot in O(log n). Every value in left
+    // must be <= pivot <= every value in right, and both trees must use the
+    // same memory resource.
+    static RBT join(RBT&& left, T pivot, RBT&& right) {
+        if (left.resource() != right.resource()) {
+            throw invalid_argument("RBT::join: trees use different memory resources");
+        }
+        if ((left.root != nullptr && pivot < left.maxValueNode(left.root)->data) ||
+            (right.root != nullptr && right.minValueNode(right.root)->data < pivot)) {
+            throw invalid_argument("RBT::join: trees are not ordered around the pivot");
+        }
+
+        RBT joined(left.resource());
+        joined.adoptStorage(left);
+        joined.adoptStorage(right);
+        TreeNode* node = joined.createNode(pivot);
+        joined.root = joined.joinTrees(left.root, blackHeight(left.root), node, right.root, blackHeight(right.root));
+        left.root = nullptr;
+        right.root = nullptr;
+        return joined;
+    }
 
     void insert(T value) {
-        Node<T>* newNode = new Node<T>(value);
+        TreeNode* newNode = createNode(value);
         insertNode(newNode);
         insertFixUp(newNode);
     }
 
+    // Inserts value as the in-order successor of hint, a node of this tree
+    // the caller expects to precede it, and returns the new node so that
+    // ascending input can pass it back as the next hint. The position is
+    // checked through parent links; a null or wrong hint costs a normal
+    // descent instead.
+    TreeNode* insert(TreeNode* hint, T value) {
+        TreeNode* newNode = createNode(value);
+        if (hint == nullptr || value < hint->data || !insertAfter(hint, newNode)) {
+            insertNode(newNode);
+        }
+        insertFixUp(newNode);
+        return newNode;
+    }
+
+    // Inserts value unless an equal one is already present, in one descent
+    // that remembers the last node not above value. Returns whether it did.
+    bool insert_unique(T value) {
+        TreeNode* parent = nullptr;
+        TreeNode* candidate = nullptr;
+        TreeNode* current = root;
+        while (current != nullptr) {
+            parent = current;
+            if (value < current->data) {
+                current = current->left;
+            } else {
+                candidate = current;
+                current = current->right;
+            }
+        }
+        if (candidate != nullptr && !(candidate->data < value)) {
+            return false;
+        }
+
+        TreeNode* newNode = createNode(value);
+        linkLeaf(newNode, parent);
+        if constexpr (OrderStatistics) {
+            for (TreeNode* ancestor = parent; ancestor != nullptr; ancestor = ancestor->parent) {
+                ++ancestor->size;
+            }
+        }
+        insertFixUp(newNode);
+        return true;
+    }
+
     void remove(T value) {
-        Node<T>* node = search(root, value);
+        TreeNode* node = search(root, value);
         if (node != nullptr) {
             deleteNode(node);
+            if (root == nullptr) {
+                releaseBlocks();
+            }
+        }
+    }
+
+    size_t size() const {
+        static_assert(OrderStatistics, "size() needs RBT<T, true>");
+        return subtreeSize(root);
+    }
+
+    // The k-th smallest value, counting from 0.
+    const T& select(size_t k) const {
+        static_assert(OrderStatistics, "select() needs RBT<T, true>");
+        if (k >= subtreeSize(root)) {
+            throw out_of_range("RBT::select: index out of range");
+        }
+        TreeNode* node = root;
+        while (true) {
+            size_t leftSize = subtreeSize(node->left);
+            if (k < leftSize) {
+                node = node->left;
+            } else if (k > leftSize) {
+                k -= leftSize + 1;
+                node = node->right;
+            } else {
+                return node->data;
+            }
+        }
+    }
+
+    // How many values are smaller than value.
+    size_t rank(const T& value) const {
+        static_assert(OrderStatistics, "rank() needs RBT<T, true>");
+        return countBelow(value, false);
+    }
+
+    // How many values lie in the closed range [lo, hi].
+    size_t count(const T& lo, const T& hi) const {
+        static_assert(OrderStatistics, "count() needs RBT<T, true>");
+        if (hi < lo) {
+            return 0;
+        }
+        return countBelow(hi, true) - countBelow(lo, false);
+    }
+
+    // Calls visit(value) for every value in the closed range [lo, hi], in
+    // ascending order.
+    template<typename Visit>
+    void forEachInRange(const T& lo, const T& hi, Visit&& visit) const {
+        for (TreeNode* node = lowerBound(lo); node != nullptr && !(hi < node->data); node = successor(node)) {
+            visit(node->data);
         }
     }
 
@@ -37,18 +308,242 @@ public:
         return printInOrder(root);
     }
 
-    bool search(T value) {
-        Node<T>* nodeFound = search(root, value);
+    bool search(const T& value) const {
+        TreeNode* nodeFound = search(root, value);
         return (nodeFound != nullptr);
     }
 
 private:
-    void insertNode(Node<T>* node) {
-        Node<T>* parent = nullptr;
-        Node<T>* current = root;
+    TreeNode* createNode(T value) {
+        if (freeNodes != nullptr) {
+            TreeNode* node = reinterpret_cast<TreeNode*>(freeNodes);
+            freeNodes = freeNodes->next;
+            new (node) TreeNode(value);
+            node->inBlock = true;
+            return node;
+        }
+        TreeNode* node = alloc.allocate(1);
+        new (node) TreeNode(value);
+        return node;
+    }
+
+    void destroyNode(TreeNode* node) {
+        bool inBlock = node->inBlock;
+        node->~TreeNode();
+        if (inBlock) {
+            recycleNode(node);
+        } else {
+            alloc.deallocate(node, 1);
+        }
+    }
+
+    void recycleNode(TreeNode* node) {
+        freeNodes = new (node) FreeNode{freeNodes};
+    }
+
+    // With the tree empty, its blocks hold no live node of this tree, so
+    // its share of them goes, and with it the free nodes they hold.
+    void releaseBlocks() {
+        blocks.clear();
+        freeNodes = nullptr;
+    }
+
+    // Takes over another tree's node blocks and recycled nodes.
+    void adoptStorage(RBT& other) {
+        vector<shared_ptr<NodeBlock>> merged;
+        merged.reserve(blocks.size() + other.blocks.size());
+        set_union(blocks.begin(), blocks.end(), other.blocks.begin(), other.blocks.end(), back_inserter(merged));
+        blocks = std::move(merged);
+        other.blocks.clear();
+        while (other.freeNodes != nullptr) {
+            FreeNode* next = other.freeNodes->next;
+            other.freeNodes->next = freeNodes;
+            freeNodes = other.freeNodes;
+            other.freeNodes = next;
+        }
+    }
+
+    static size_t subtreeSize(const TreeNode* node) {
+        if constexpr (OrderStatistics) {
+            return node != nullptr ? node->size : 0;
+        } else {
+            return 0;
+        }
+    }
+
+    static void updateSize(TreeNode* node) {
+        if constexpr (OrderStatistics) {
+            node->size = 1 + subtreeSize(node->left) + subtreeSize(node->right);
+        }
+    }
+
+    // Number of values v in the tree with v < value, or v <= value when inclusive.
+    size_t countBelow(const T& value, bool inclusive) const {
+        size_t below = 0;
+        for (TreeNode* node = root; node != nullptr;) {
+            if (node->data < value || (inclusive && !(value < node->data))) {
+                below += subtreeSize(node->left) + 1;
+                node = node->right;
+            } else {
+                node = node->left;
+            }
+        }
+        return below;
+    }
+
+    // Number of black nodes on any path from node down to a leaf, node included.
+    static int blackHeight(TreeNode* node) {
+        int height = 0;
+        for (; node != nullptr; node = node->left) {
+            if (node->color == 'B') {
+                ++height;
+            }
+        }
+        return height;
+    }
+
+    // Detaches a subtree so it can be treated as a tree of its own; a red root
+    // is blackened, which adds one to its black height.
+    static TreeNode* detach(TreeNode* node, int& height) {
+        if (node != nullptr) {
+            node->parent = nullptr;
+            if (node->color == 'R') {
+                node->color = 'B';
+                ++height;
+            }
+        }
+        return node;
+    }
+
+    // Joins two black-rooted trees around pivot and returns the new root,
+    // using this tree's root as scratch for the rotations. The taller tree's
+    // spine is followed down to a black node of the shorter tree's black
+    // height; pivot is attached there in red and insertFixUp repairs the
+    // rest. height receives the black height of the result.
+    TreeNode* joinTrees(TreeNode* left, int leftHeight, TreeNode* pivot, TreeNode* right, int rightHeight, int& height) {
+        pivot->parent = nullptr;
+        if (leftHeight == rightHeight) {
+            pivot->left = left;
+            pivot->right = right;
+            if (left != nullptr) left->parent = pivot;
+            if (right != nullptr) right->parent = pivot;
+            pivot->color = 'B';
+            updateSize(pivot);
+            height = leftHeight + 1;
+            return pivot;
+        }
+
+        TreeNode* parent = nullptr;
+        if (leftHeight > rightHeight) {
+            root = left;
+            TreeNode* node = left;
+            int nodeHeight = leftHeight;
+            while (node != nullptr && !(node->color == 'B' && nodeHeight == rightHeight)) {
+                if (node->color == 'B') --nodeHeight;
+                parent = node;
+                node = node->right;
+            }
+            parent->right = pivot;
+            pivot->left = node;
+            pivot->right = right;
+            if (node != nullptr) node->parent = pivot;
+            if (right != nullptr) right->parent = pivot;
+            height = leftHeight;
+        } else {
+            root = right;
+            TreeNode* node = right;
+            int nodeHeight = rightHeight;
+            while (node != nullptr && !(node->color == 'B' && nodeHeight == leftHeight)) {
+                if (node->color == 'B') --nodeHeight;
+                parent = node;
+                node = node->left;
+            }
+            parent->left = pivot;
+            pivot->right = node;
+            pivot->left = left;
+            if (node != nullptr) node->parent = pivot;
+            if (left != nullptr) left->parent = pivot;
+            height = rightHeight;
+        }
+
+        pivot->parent = parent;
+        pivot->color = 'R';
+        if constexpr (OrderStatistics) {
+            for (TreeNode* ancestor = pivot; ancestor != nullptr; ancestor = ancestor->parent) {
+                updateSize(ancestor);
+            }
+        }
+        if (insertFixUp(pivot)) {
+            ++height;
+        }
+        return root;
+    }
+
+    TreeNode* joinTrees(TreeNode* left, int leftHeight, TreeNode* pivot, TreeNode* right, int rightHeight) {
+        int height;
+        return joinTrees(left, leftHeight, pivot, right, rightHeight, height);
+    }
+
+    // Splits the tree under node (of black height height) into values below
+    // key and the rest, joining the pieces back up on the way out.
+    void splitTree(TreeNode* node, int height, const T& key, TreeNode*& lower, int& lowerHeight, TreeNode*& upper, int& upperHeight) {
+        if (node == nullptr) {
+            lower = upper = nullptr;
+            lowerHeight = upperHeight = 0;
+            return;
+        }
+
+        int childHeight = node->color == 'B' ? height - 1 : height;
+        int leftHeight = childHeight;
+        int rightHeight = childHeight;
+        TreeNode* left = detach(node->left, leftHeight);
+        TreeNode* right = detach(node->right, rightHeight);
+        node->left = node->right = nullptr;
+
+        if (node->data < key) {
+            TreeNode* rightLower;
+            int rightLowerHeight;
+            splitTree(right, rightHeight, key, rightLower, rightLowerHeight, upper, upperHeight);
+            lower = joinTrees(left, leftHeight, node, rightLower, rightLowerHeight, lowerHeight);
+        } else {
+            TreeNode* leftUpper;
+            int leftUpperHeight;
+            splitTree(left, leftHeight, key, lower, lowerHeight, leftUpper, leftUpperHeight);
+            upper = joinTrees(leftUpper, leftUpperHeight, node, right, rightHeight, upperHeight);
+        }
+    }
+
+    TreeNode* linkBalanced(TreeNode* nodes, size_t lo, size_t hi, TreeNode* parent, int depth, int redDepth) {
+        if (lo == hi) {
+            return nullptr;
+        }
+        size_t mid = lo + (hi - lo) / 2;
+        TreeNode* node = &nodes[mid];
+        node->parent = parent;
+        node->color = depth == redDepth ? 'R' : 'B';
+        node->left = linkBalanced(nodes, lo, mid, node, depth + 1, redDepth);
+        node->right = linkBalanced(nodes, mid + 1, hi, node, depth + 1, redDepth);
+        updateSize(node);
+        return node;
+    }
+
+    void destroyTree(TreeNode* node) {
+        if (node != nullptr) {
+            destroyTree(node->left);
+            destroyTree(node->right);
+            destroyNode(node);
+        }
+    }
+
+    void insertNode(TreeNode* node) {
+        TreeNode* parent = nullptr;
+        TreeNode* current = root;
 
         while (current != nullptr) {
             parent = current;
+            if constexpr (OrderStatistics) {
+                ++current->size;
+            }
             if (node->data < current->data) {
                 current = current->left;
             } else {
@@ -56,28 +551,89 @@ private:
             }
         }
 
+        linkLeaf(node, parent);
+    }
+
+    // Hangs node, as a red leaf, below parent found by a descent.
+    void linkLeaf(TreeNode* node, TreeNode* parent) {
         node->parent = parent;
 
         if (parent == nullptr) {
             root = node;
+            rightmost = node;
         } else if (node->data < parent->data) {
             parent->left = node;
         } else {
             parent->right = node;
+            if (parent == rightmost) {
+                rightmost = node;
+            }
+        }
+
+        node->left = nullptr;
+        node->right = nullptr;
+        node->color = 'R';
+    }
+
+    // Links node in right after hint if its value fits between hint and
+    // hint's successor. Appending after the known largest node needs no
+    // climb; otherwise the successor is at most a walk away, which in-order
+    // insertion sequences pay only amortized O(1) times per node.
+    bool insertAfter(TreeNode* hint, TreeNode* node) {
+        TreeNode* parent = hint;
+        bool asLeft = false;
+        if (hint != rightmost) {
+            if (hint->right != nullptr) {
+                TreeNode* successor = minValueNode(hint->right);
+                if (successor->data < node->data) {
+                    return false;
+                }
+                parent = successor;
+                asLeft = true;
+            } else {
+                TreeNode* child = hint;
+                TreeNode* successor = hint->parent;
+                while (successor != nullptr && child == successor->right) {
+                    child = successor;
+                    successor = successor->parent;
+                }
+                if (successor != nullptr && successor->data < node->data) {
+                    return false;
+                }
+                if (successor == nullptr) {
+                    rightmost = hint;
+                }
+            }
         }
 
+        node->parent = parent;
         node->left = nullptr;
         node->right = nullptr;
         node->color = 'R';
+        if (asLeft) {
+            parent->left = node;
+        } else {
+            parent->right = node;
+            if (parent == rightmost) {
+                rightmost = node;
+            }
+        }
+        if constexpr (OrderStatistics) {
+            for (TreeNode* ancestor = parent; ancestor != nullptr; ancestor = ancestor->parent) {
+                ++ancestor->size;
+            }
+        }
+        return true;
     }
 
-    void insertFixUp(Node<T>* node) {
+    // Returns true when the final recolouring of the root raised the black height.
+    bool insertFixUp(TreeNode* node) {
         while (node != root && node->parent->color == 'R') {
-            Node<T>* parent = node->parent;
-            Node<T>* grandparent = parent->parent;
+            TreeNode* parent = node->parent;
+            TreeNode* grandparent = parent->parent;
 
             if (parent == grandparent->left) {
-                Node<T>* uncle = grandparent->right;
+                TreeNode* uncle = grandparent->right;
                 if (uncle != nullptr && uncle->color == 'R') {
                     parent->color = 'B';
                     uncle->color = 'B';
@@ -94,7 +650,7 @@ private:
                     rotateRight(grandparent);
                 }
             } else {
-                Node<T>* uncle = grandparent->left;
+                TreeNode* uncle = grandparent->left;
                 if (uncle != nullptr && uncle->color == 'R') {
                     parent->color = 'B';
                     uncle->color = 'B';
@@ -112,11 +668,13 @@ private:
                 }
             }
         }
+        bool grew = root->color == 'R';
         root->color = 'B';
+        return grew;
     }
 
-    void rotateLeft(Node<T>* node) {
-        Node<T>* rightChild = node->right;
+    void rotateLeft(TreeNode* node) {
+        TreeNode* rightChild = node->right;
         node->right = rightChild->left;
         if (rightChild->left != nullptr) {
             rightChild->left->parent = node;
@@ -131,10 +689,12 @@ private:
         }
         rightChild->left = node;
         node->parent = rightChild;
+        updateSize(node);
+        updateSize(rightChild);
     }
 
-    void rotateRight(Node<T>* node) {
-        Node<T>* leftChild = node->left;
+    void rotateRight(TreeNode* node) {
+        TreeNode* leftChild = node->left;
         node->left = leftChild->right;
         if (leftChild->right != nullptr) {
             leftChild->right->parent = node;
@@ -149,19 +709,28 @@ private:
         }
         leftChild->right = node;
         node->parent = leftChild;
+        updateSize(node);
+        updateSize(leftChild);
     }
 
-    void deleteNode(Node<T>* node) {
-    Node<T>* replace;
-    Node<T>* temp = node;
-    Node<T>* x;
+    void deleteNode(TreeNode* node) {
+    TreeNode* replace;
+    TreeNode* temp = node;
+    TreeNode* x;
+    TreeNode* xParent;
     char temp_original_color = temp->color;
 
+    if (node == rightmost) {
+        rightmost = node->left != nullptr ? maxValueNode(node->left) : node->parent;
+    }
+
     if (node->left == nullptr) {
         x = node->right;
+        xParent = node->parent;
         transplant(node, node->right);
     } else if (node->right == nullptr) {
         x = node->left;
+        xParent = node->parent;
         transplant(node, node->left);
     } else {
         temp = minValueNode(node->right);
@@ -169,8 +738,10 @@ private:
         x = temp->right;
 
         if (temp->parent == node) {
+            xParent = temp;
             if (x) x->parent = temp; // Asegurarse de que x no es nullptr antes de asignarle un padre.
         } else {
+            xParent = temp->parent;
             transplant(temp, temp->right);
             temp->right = node->right;
             temp->right->parent = temp;
@@ -181,14 +752,20 @@ private:
         temp->left->parent = temp;
         temp->color = node->color;
     }
-    delete node;
+    destroyNode(node);
+
+    if constexpr (OrderStatistics) {
+        for (TreeNode* ancestor = xParent; ancestor != nullptr; ancestor = ancestor->parent) {
+            updateSize(ancestor);
+        }
+    }
 
     if (temp_original_color == 'B') {
-        deleteFixUp(x);
+        deleteFixUp(x, xParent);
     }
 }
 
-    void transplant(Node<T>* u, Node<T>* v) {
+    void transplant(TreeNode* u, TreeNode* v) {
         if (u->parent == nullptr) {
             root = v;
         } else if (u == u->parent->left) {
@@ -201,55 +778,57 @@ private:
         }
     }
 
-    void deleteFixUp(Node<T>* node) {
-    while (node != root && node != nullptr && node->color == 'B') {
-        if (node == node->parent->left) {
-            Node<T>* sibling = node->parent->right;
+    void deleteFixUp(TreeNode* node, TreeNode* parent) {
+    while (node != root && (node == nullptr || node->color == 'B')) {
+        if (node == parent->left) {
+            TreeNode* sibling = parent->right;
             if (sibling && sibling->color == 'R') {
                 sibling->color = 'B';
-                node->parent->color = 'R';
-                rotateLeft(node->parent);
-                sibling = node->parent->right;
+                parent->color = 'R';
+                rotateLeft(parent);
+                sibling = parent->right;
             }
             if (sibling && (!sibling->left || sibling->left->color == 'B') && (!sibling->right || sibling->right->color == 'B')) {
                 sibling->color = 'R';
-                node = node->parent;
+                node = parent;
+                parent = node->parent;
             } else {
-                if (sibling && sibling->right && sibling->right->color == 'B') {
+                if (sibling && (!sibling->right || sibling->right->color == 'B')) {
                     if (sibling->left) sibling->left->color = 'B';
                     sibling->color = 'R';
                     rotateRight(sibling);
-                    sibling = node->parent->right;
+                    sibling = parent->right;
                 }
-                if (sibling) sibling->color = node->parent->color;
-                node->parent->color = 'B';
+                if (sibling) sibling->color = parent->color;
+                parent->color = 'B';
                 if (sibling && sibling->right) sibling->right->color = 'B';
-                rotateLeft(node->parent);
+                rotateLeft(parent);
                 node = root;
             }
         } else {
             // Simétrico al caso anterior, con 'left' y 'right' intercambiados
-            Node<T>* sibling = node->parent->left;
+            TreeNode* sibling = parent->left;
             if (sibling && sibling->color == 'R') {
                 sibling->color = 'B';
-                node->parent->color = 'R';
-                rotateRight(node->parent);
-                sibling = node->parent->left;
+                parent->color = 'R';
+                rotateRight(parent);
+                sibling = parent->left;
             }
             if (sibling && (!sibling->right || sibling->right->color == 'B') && (!sibling->left || sibling->left->color == 'B')) {
                 sibling->color = 'R';
-                node = node->parent;
+                node = parent;
+                parent = node->parent;
             } else {
-                if (sibling && sibling->left && sibling->left->color == 'B') {
+                if (sibling && (!sibling->left || sibling->left->color == 'B')) {
                     if (sibling->right) sibling->right->color = 'B';
                     sibling->color = 'R';
                     rotateLeft(sibling);
-                    sibling = node->parent->left;
+                    sibling = parent->left;
                 }
-                if (sibling) sibling->color = node->parent->color;
-                node->parent->color = 'B';
+                if (sibling) sibling->color = parent->color;
+                parent->color = 'B';
                 if (sibling && sibling->left) sibling->left->color = 'B';
-                rotateRight(node->parent);
+                rotateRight(parent);
                 node = root;
             }
         }
@@ -257,26 +836,67 @@ private:
     if (node) node->color = 'B';
 }
 
-    Node<T>* minValueNode(Node<T>* node) {
-        Node<T>* current = node;
+    TreeNode* maxValueNode(TreeNode* node) {
+        TreeNode* current = node;
+        while (current->right != nullptr) {
+            current = current->right;
+        }
+        return current;
+    }
+
+    TreeNode* minValueNode(TreeNode* node) {
+        TreeNode* current = node;
         while (current->left != nullptr) {
             current = current->left;
         }
         return current;
     }
 
-    Node<T>* search(Node<T>* node, T value) {
-        if (node == nullptr || node->data == value) {
+    // The first node whose value is not less than value.
+    TreeNode* lowerBound(const T& value) const {
+        TreeNode* found = nullptr;
+        for (TreeNode* node = root; node != nullptr;) {
+            if (node->data < value) {
+                node = node->right;
+            } else {
+                found = node;
+                node = node->left;
+            }
+        }
+        return found;
+    }
+
+    static TreeNode* successor(TreeNode* node) {
+        if (node->right != nullptr) {
+            node = node->right;
+            while (node->left != nullptr) {
+                node = node->left;
+            }
             return node;
         }
-        if (value < node->data) {
-            return search(node->left, value);
-        } else {
-            return search(node->right, value);
+        TreeNode* parent = node->parent;
+        while (parent != nullptr && node == parent->right) {
+            node = parent;
+            parent = parent->parent;
         }
+        return parent;
     }
 
-    string printInOrder(Node<T>* node) {
+    // Same descent as AVL::search; finds the first of equal values.
+    TreeNode* search(TreeNode* node, const T& value) const {
+        TreeNode* candidate = nullptr;
+        while (node != nullptr) {
+            if (node->data < value) {
+                node = node->right;
+            } else {
+                candidate = node;
+                node = node->left;
+            }
+        }
+        return candidate != nullptr && !(value < candidate->data) ? candidate : nullptr;
+    }
+
+    string printInOrder(TreeNode* node) {
         if (node == nullptr) {
             return "";
         }
@@ -286,4 +906,6 @@ private:
         result += printInOrder(node->right);
         return result;
     }
-};
\ No newline at end of file
+};
+
+#endif // RED_BLACK_TREE_H
@@ -0,0 +1,300 @@
+#ifndef SHARDED_RBT_H
+#define SHARDED_RBT_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+#include "Red-Black-Tree.h"
+#include "Epoch.h"
+
+// Ordered set split into key-range shards, each an RBT behind its own lock,
+// so writers to different ranges never wait on each other. Shard i holds the
+// keys in [bounds[i - 1], bounds[i]).
+//
+// The shard directory is immutable once published: a split or merge builds
+// a new one, swaps it in and retires the old directory and the replaced
+// shards to Epoch. An operation finds its shard without locking the
+// directory, locks the shard and retries if it has been replaced meanwhile.
+//
+// Shards are kept near targetShards and near equal size. Every
+// CHECK_INTERVAL inserts or deletes a shard compares itself with the
+// average: it splits at its median when it is more than SKEW times the
+// average, or merely above average while there are fewer than targetShards,
+// and it merges with its smaller neighbour when it is SKEW times below it.
+template<typename T>
+class ShardedRBT {
+public:
+    using Tree = RBT<T, true>;
+
+    static constexpr std::size_t DEFAULT_SHARDS = 64;
+    static constexpr std::size_t CHECK_INTERVAL = 1024;
+    static constexpr std::size_t MIN_SPLIT_SIZE = 4096;
+    static constexpr std::size_t SKEW = 2;
+
+    explicit ShardedRBT(std::size_t targetShards = DEFAULT_SHARDS) : ShardedRBT(std::vector<T>(), targetShards) {}
+
+    // Starts with one shard per gap between the ascending boundaries.
+    ShardedRBT(std::vector<T> bounds, std::size_t targetShards = DEFAULT_SHARDS)
+        : target(std::max<std::size_t>(targetShards, 1)) {
+        Directory* initial = new Directory;
+        initial->shards.push_back(new Shard(Tree()));
+        for (T& bound : bounds) {
+            if (initial->bounds.empty() || initial->bounds.back() < bound) {
+                initial->bounds.push_back(std::move(bound));
+                initial->shards.push_back(new Shard(Tree()));
+            }
+        }
+        directory.store(initial, std::memory_order_release);
+    }
+
+    ShardedRBT(const ShardedRBT&) = delete;
+    ShardedRBT& operator=(const ShardedRBT&) = delete;
+
+    // No other thread may still be using the set.
+    ~ShardedRBT() {
+        Directory* current = directory.load(std::memory_order_relaxed);
+        for (Shard* shard : current->shards) {
+            delete shard;
+        }
+        delete current;
+    }
+
+    // Returns whether key was added; keys already present are left alone.
+    bool insert(const T& key) {
+        Epoch::Guard guard;
+        std::size_t size;
+        while (true) {
+            Shard* shard = locate(key);
+            std::unique_lock<std::shared_mutex> lock(shard->lock);
+            if (shard->retired) {
+                continue;
+            }
+            if (shard->tree.search(key)) {
+                return false;
+            }
+            shard->tree.insert(key);
+            size = shard->tree.size();
+            shard->size.store(size, std::memory_order_relaxed);
+            break;
+        }
+        if (size % CHECK_INTERVAL == 0) {
+            rebalance(key);
+        }
+        return true;
+    }
+
+    bool remove(const T& key) {
+        Epoch::Guard guard;
+        std::size_t size;
+        while (true) {
+            Shard* shard = locate(key);
+            std::unique_lock<std::shared_mutex> lock(shard->lock);
+            if (shard->retired) {
+                continue;
+            }
+            if (!shard->tree.search(key)) {
+                return false;
+            }
+            shard->tree.remove(key);
+            size = shard->tree.size();
+            shard->size.store(size, std::memory_order_relaxed);
+            break;
+        }
+        if (size % CHECK_INTERVAL == 0) {
+            rebalance(key);
+        }
+        return true;
+    }
+
+    bool search(const T& key) const {
+        Epoch::Guard guard;
+        while (true) {
+            Shard* shard = locate(key);
+            std::shared_lock<std::shared_mutex> lock(shard->lock);
+            if (!shard->retired) {
+                return shard->tree.search(key);
+            }
+        }
+    }
+
+    // Calls visit(key) for every key in [lo, hi] in ascending order. Each
+    // shard is read under its lock, but the scan as a whole is not atomic:
+    // updates to shards it has not reached yet may or may not be seen.
+    template<typename Visit>
+    void forEachInRange(const T& lo, const T& hi, Visit&& visit) const {
+        if (hi < lo) {
+            return;
+        }
+        Epoch::Guard guard;
+        T from = lo;
+        while (true) {
+            Directory* current = directory.load(std::memory_order_acquire);
+            std::size_t index = current->indexOf(from);
+            Shard* shard = current->shards[index];
+            std::shared_lock<std::shared_mutex> lock(shard->lock);
+            if (shard->retired) {
+                continue;
+            }
+            // A live shard still covers the range current gave it.
+            shard->tree.forEachInRange(from, hi, visit);
+            if (index + 1 == current->shards.size() || hi < current->bounds[index]) {
+                return;
+            }
+            from = current->bounds[index];
+        }
+    }
+
+    // Exact only while no update is running.
+    std::size_t size() const {
+        Epoch::Guard guard;
+        std::size_t total = 0;
+        for (Shard* shard : directory.load(std::memory_order_acquire)->shards) {
+            total += shard->size.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    std::size_t shardCount() const {
+        Epoch::Guard guard;
+        return directory.load(std::memory_order_acquire)->shards.size();
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::shared_mutex lock;
+        Tree tree;
+        std::atomic<std::size_t> size;
+        // Set under lock once the shard's keys have moved to other shards.
+        bool retired = false;
+
+        explicit Shard(Tree&& keys) : tree(std::move(keys)), size(0) {
+            size.store(tree.size(), std::memory_order_relaxed);
+        }
+    };
+
+    struct Directory {
+        std::vector<T> bounds;
+        std::vector<Shard*> shards;
+
+        std::size_t indexOf(const T& key) const {
+            return std::upper_bound(bounds.begin(), bounds.end(), key) - bounds.begin();
+        }
+    };
+
+    Shard* locate(const T& key) const {
+        Directory* current = directory.load(std::memory_order_acquire);
+        return current->shards[current->indexOf(key)];
+    }
+
+    // Runs at most one split or merge at a time; a thread that finds another
+    // one in progress skips its check instead of queueing behind it.
+    void rebalance(const T& key) {
+        std::unique_lock<std::mutex> lock(rebalancer, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return;
+        }
+        Directory* current = directory.load(std::memory_order_acquire);
+        std::size_t count = current->shards.size();
+        std::size_t total = 0;
+        for (Shard* shard : current->shards) {
+            total += shard->size.load(std::memory_order_relaxed);
+        }
+        std::size_t index = current->indexOf(key);
+        std::size_t size = current->shards[index]->size.load(std::memory_order_relaxed);
+
+        if (size >= MIN_SPLIT_SIZE && (size * count > SKEW * total || (count < target && size * count >= total))) {
+            current = split(current, index);
+            if (current->shards.size() > target) {
+                // Merge the smallest neighbouring pair that includes neither
+                // of the two halves just split off.
+                std::size_t smallest = current->shards.size();
+                for (std::size_t i = 0; i + 1 < current->shards.size(); ++i) {
+                    bool touchesHalves = i + 1 >= index && i <= index + 1;
+                    if (!touchesHalves && (smallest == current->shards.size() || pairSize(current, i) < pairSize(current, smallest))) {
+                        smallest = i;
+                    }
+                }
+                if (smallest != current->shards.size()) {
+                    merge(current, smallest);
+                }
+            }
+        } else if (count > 1 && size * count * SKEW < total) {
+            if (index == 0 || (index + 1 < count && pairSize(current, index) < pairSize(current, index - 1))) {
+                merge(current, index);
+            } else {
+                merge(current, index - 1);
+            }
+        }
+    }
+
+    static std::size_t pairSize(const Directory* current, std::size_t index) {
+        return current->shards[index]->size.load(std::memory_order_relaxed) +
+               current->shards[index + 1]->size.load(std::memory_order_relaxed);
+    }
+
+    // Both replace shards in current, which must be the published directory,
+    // and return the directory that replaces it.
+    Directory* split(Directory* current, std::size_t index) {
+        Shard* shard = current->shards[index];
+        Directory* next;
+        {
+            std::unique_lock<std::shared_mutex> lock(shard->lock);
+            std::size_t size = shard->tree.size();
+            if (size < 2) {
+                return current;
+            }
+            T median = shard->tree.select(size / 2);
+            auto halves = shard->tree.split(median);
+            next = new Directory(*current);
+            next->bounds.insert(next->bounds.begin() + index, median);
+            next->shards[index] = new Shard(std::move(halves.first));
+            next->shards.insert(next->shards.begin() + index + 1, new Shard(std::move(halves.second)));
+            directory.store(next, std::memory_order_release);
+            shard->retired = true;
+        }
+        Epoch::retire(shard);
+        Epoch::retire(current);
+        return next;
+    }
+
+    Directory* merge(Directory* current, std::size_t index) {
+        Shard* left = current->shards[index];
+        Shard* right = current->shards[index + 1];
+        Directory* next;
+        {
+            std::unique_lock<std::shared_mutex> leftLock(left->lock);
+            std::unique_lock<std::shared_mutex> rightLock(right->lock);
+            Shard* joined;
+            if (right->tree.size() == 0) {
+                joined = new Shard(std::move(left->tree));
+            } else {
+                // RBT::join needs a pivot, so the smallest key on the right
+                // is taken out to serve as one.
+                T pivot = right->tree.select(0);
+                right->tree.remove(pivot);
+                joined = new Shard(Tree::join(std::move(left->tree), pivot, std::move(right->tree)));
+            }
+            next = new Directory(*current);
+            next->bounds.erase(next->bounds.begin() + index);
+            next->shards[index] = joined;
+            next->shards.erase(next->shards.begin() + index + 1);
+            directory.store(next, std::memory_order_release);
+            left->retired = true;
+            right->retired = true;
+        }
+        Epoch::retire(left);
+        Epoch::retire(right);
+        Epoch::retire(current);
+        return next;
+    }
+
+    std::atomic<Directory*> directory;
+    std::mutex rebalancer;
+    std::size_t target;
+};
+
+#endif // SHARDED_RBT_H
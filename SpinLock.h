@@ -0,0 +1,35 @@
+#ifndef SPIN_LOCK_H
+#define SPIN_LOCK_H
+
+#include <atomic>
+#include <thread>
+
+// Test-and-test-and-set lock, small enough for every node to carry one.
+// Waiters spin briefly and then yield, since the holder may be descheduled.
+class SpinLock {
+public:
+    static constexpr int SPINS_BEFORE_YIELD = 64;
+
+    void lock() {
+        while (locked.exchange(true, std::memory_order_acquire)) {
+            for (int spins = 0; locked.load(std::memory_order_relaxed); ++spins) {
+                if (spins >= SPINS_BEFORE_YIELD) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+
+    bool try_lock() {
+        return !locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock() {
+        locked.store(false, std::memory_order_release);
+    }
+
+private:
+    std::atomic<bool> locked{false};
+};
+
+#endif // SPIN_LOCK_H
@@ -0,0 +1,142 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Small fork-join pool. The thread calling parallelInvoke counts as one of the
+// pool's threads: it runs one branch itself and, while waiting for the other,
+// executes queued tasks instead of blocking, so nested forks cannot deadlock.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency()) : stopping(false) {
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    unsigned size() const {
+        return static_cast<unsigned>(workers.size()) + 1;
+    }
+
+    // Runs left on the calling thread and right on whichever thread picks it
+    // up first; returns once both have finished.
+    template<typename Left, typename Right>
+    void parallelInvoke(Left&& left, Right&& right) {
+        if (workers.empty()) {
+            left();
+            right();
+            return;
+        }
+
+        Task task;
+        task.run = [](void* fn) { (*static_cast<std::remove_reference_t<Right>*>(fn))(); };
+        task.fn = &right;
+        push(&task);
+
+        std::exception_ptr leftError;
+        try {
+            left();
+        } catch (...) {
+            leftError = std::current_exception();
+        }
+
+        while (!task.done.load(std::memory_order_acquire)) {
+            if (!runNewest()) {
+                std::this_thread::yield();
+            }
+        }
+
+        if (leftError) {
+            std::rethrow_exception(leftError);
+        }
+        if (task.error) {
+            std::rethrow_exception(task.error);
+        }
+    }
+
+private:
+    struct Task {
+        void (*run)(void*) = nullptr;
+        void* fn = nullptr;
+        std::exception_ptr error;
+        std::atomic<bool> done{false};
+    };
+
+    void push(Task* task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(task);
+        }
+        wakeup.notify_one();
+    }
+
+    // Waiting forkers take the newest task, most likely their own child; idle
+    // workers take the oldest, which is usually the biggest.
+    bool runNewest() {
+        Task* task;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (tasks.empty()) {
+                return false;
+            }
+            task = tasks.back();
+            tasks.pop_back();
+        }
+        execute(task);
+        return true;
+    }
+
+    static void execute(Task* task) {
+        try {
+            task->run(task->fn);
+        } catch (...) {
+            task->error = std::current_exception();
+        }
+        task->done.store(true, std::memory_order_release);
+    }
+
+    void workerLoop() {
+        while (true) {
+            Task* task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeup.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = tasks.front();
+                tasks.pop_front();
+            }
+            execute(task);
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::deque<Task*> tasks;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,66 @@
+#include <iostream>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "BenchmarkResults.h"
+
+using namespace std;
+
+// Compares a benchmark CSV (AVL suite SIZE --csv=FILE) against a stored baseline.
+// A phase regressed when its median ns/op grew by more than the threshold
+// and its confidence interval lies entirely above the baseline's, so noise
+// that moves the median but not the interval is not flagged. Exits with 1
+// when anything regressed, so a build script can stop on it.
+int main(int argc, char* argv[]) {
+    if (argc < 3 || argc > 4) {
+        cerr << "Usage: " << argv[0] << " baseline.csv current.csv [threshold-percent, default 5]" << endl;
+        return 2;
+    }
+    double threshold = argc > 3 ? atof(argv[3]) / 100 : 0.05;
+
+    vector<BenchmarkResult> baseline;
+    vector<BenchmarkResult> current;
+    try {
+        baseline = readCsv(argv[1]);
+        current = readCsv(argv[2]);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 2;
+    }
+
+    using Key = tuple<string, string, string, size_t>;
+    map<Key, Summary> before;
+    for (const BenchmarkResult& r : baseline) {
+        before[{r.engine, r.workload, r.phase, r.size}] = r.nsPerOp;
+    }
+
+    int regressions = 0;
+    int improvements = 0;
+    int unmatched = 0;
+    for (const BenchmarkResult& r : current) {
+        string label = r.engine + ", " + r.workload + ", " + r.phase + ", " + to_string(r.size);
+        auto it = before.find({r.engine, r.workload, r.phase, r.size});
+        if (it == before.end()) {
+            cout << "NEW        " << label << ": " << r.nsPerOp.median << " ns/op" << endl;
+            ++unmatched;
+            continue;
+        }
+        const Summary& old = it->second;
+        double change = r.nsPerOp.median / old.median - 1;
+        const char* verdict = "same       ";
+        if (change > threshold && r.nsPerOp.ciLow > old.ciHigh) {
+            verdict = "REGRESSION ";
+            ++regressions;
+        } else if (change < -threshold && r.nsPerOp.ciHigh < old.ciLow) {
+            verdict = "improved   ";
+            ++improvements;
+        }
+        cout << verdict << label << ": " << old.median << " -> " << r.nsPerOp.median << " ns/op ("
+             << (change >= 0 ? "+" : "") << change * 100 << "%)" << endl;
+    }
+
+    cout << regressions << " regressed, " << improvements << " improved, " << unmatched << " not in the baseline" << endl;
+    return regressions > 0 ? 1 : 0;
+}
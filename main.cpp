@@ -1,9 +1,37 @@
 #include <iostream>
 #include <chrono>
+#include <cerrno>
+#include <climits>
 #include <cstdlib>
 #include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <shared_mutex>
 #include "AVL.h"
 #include "Red-Black-Tree.h"
+#include "CompactRBT.h"
+#include "CompactAVL.h"
+#include "IndexedAVL.h"
+#include "BTree.h"
+#include "PersistentAVL.h"
+#include "ConcurrentAVL.h"
+#include "ShardedRBT.h"
+#include "FlatCombiningAVL.h"
+#include "LockFreeSkipList.h"
+#include "BenchmarkResults.h"
+#ifdef __linux__
+#include <fstream>
+#include <unistd.h>
+#endif
 
 using namespace std;
 using namespace std::chrono;
@@ -12,70 +40,1179 @@ using namespace std::chrono;
 const vector<int> SIZES = {10000, 100000, 1000000, 10000000};
 
 
-void benchmarkAVL(const vector<int>& valuesToInsert, const vector<int>& valuesToDelete) {
-    AVL<int> avl;
+template<typename Alloc>
+void benchmarkAVLAllocator(const string& label, const vector<int>& valuesToInsert) {
+    auto* avl = new AVL<int, Alloc>();
 
     auto start = high_resolution_clock::now();
     for (int value : valuesToInsert) {
-        avl.insert(value);
+        avl->insert(value);
     }
     auto end = high_resolution_clock::now();
     auto duration = duration_cast<milliseconds>(end - start);
-    cout << "AVL insert duration (" << valuesToInsert.size() << " elements): " << duration.count() << " ms" << endl;
+    double seconds = chrono::duration<double>(end - start).count();
+    cout << "AVL (" << label << ") insert duration (" << valuesToInsert.size() << " elements): " << duration.count() << " ms";
+    if (seconds > 0) {
+        cout << " (" << static_cast<long long>(valuesToInsert.size() / seconds) << " inserts/s)";
+    }
+    cout << endl;
 
 
     start = high_resolution_clock::now();
-    for (int value : valuesToInsert) {
-        avl.search(value);
-    }
+    delete avl;
     end = high_resolution_clock::now();
     duration = duration_cast<milliseconds>(end - start);
-    cout << "AVL search duration (" << valuesToInsert.size() << " elements): " << duration.count() << " ms" << endl;
+    cout << "AVL (" << label << ") teardown duration (" << valuesToInsert.size() << " elements): " << duration.count() << " ms" << endl;
+}
+
+void benchmarkAVLRetracing(const string& order, const vector<int>& valuesToInsert, const vector<int>& valuesToDelete) {
+    {
+        AVL<int> avl;
+
+        auto start = high_resolution_clock::now();
+        for (int value : valuesToInsert) {
+            avl.root = avl.insert(avl.root, value);
+        }
+        auto end = high_resolution_clock::now();
+        auto duration = duration_cast<milliseconds>(end - start);
+        cout << "AVL recursive insert duration (" << valuesToInsert.size() << " " << order << " elements): " << duration.count() << " ms" << endl;
+
+
+        start = high_resolution_clock::now();
+        for (int value : valuesToDelete) {
+            avl.root = avl.deleteNode(avl.root, value);
+        }
+        end = high_resolution_clock::now();
+        duration = duration_cast<milliseconds>(end - start);
+        cout << "AVL recursive delete duration (" << valuesToDelete.size() << " " << order << " elements): " << duration.count() << " ms" << endl;
+    }
+
+    {
+        AVL<int> avl;
+
+        auto start = high_resolution_clock::now();
+        for (int value : valuesToInsert) {
+            avl.insert(value);
+        }
+        auto end = high_resolution_clock::now();
+        auto duration = duration_cast<milliseconds>(end - start);
+        cout << "AVL iterative insert duration (" << valuesToInsert.size() << " " << order << " elements): " << duration.count() << " ms" << endl;
+
+
+        start = high_resolution_clock::now();
+        for (int value : valuesToDelete) {
+            avl.deleteNode(value);
+        }
+        end = high_resolution_clock::now();
+        duration = duration_cast<milliseconds>(end - start);
+        cout << "AVL iterative delete duration (" << valuesToDelete.size() << " " << order << " elements): " << duration.count() << " ms" << endl;
+    }
+}
+
+void benchmarkAVLBulkLoad(const vector<int>& valuesToInsert) {
+    {
+        AVL<int> avl;
+
+        auto start = high_resolution_clock::now();
+        for (int value : valuesToInsert) {
+            avl.insert(value);
+        }
+        auto end = high_resolution_clock::now();
+        auto duration = duration_cast<milliseconds>(end - start);
+        cout << "AVL per-key insert duration (" << valuesToInsert.size() << " sorted elements): " << duration.count() << " ms" << endl;
+    }
+
+    {
+        AVL<int> avl;
+
+        auto start = high_resolution_clock::now();
+        avl.build_from_sorted(valuesToInsert.begin(), valuesToInsert.end());
+        auto end = high_resolution_clock::now();
+        auto duration = duration_cast<milliseconds>(end - start);
+        cout << "AVL build_from_sorted duration (" << valuesToInsert.size() << " sorted elements): " << duration.count() << " ms" << endl;
+    }
+}
+
+void benchmarkRBTBulkLoad(const vector<int>& valuesToInsert) {
+    {
+        RBT<int> rbt;
+
+        auto start = high_resolution_clock::now();
+        for (int value : valuesToInsert) {
+            rbt.insert(value);
+        }
+        auto end = high_resolution_clock::now();
+        auto duration = duration_cast<milliseconds>(end - start);
+        cout << "RBT per-key insert duration (" << valuesToInsert.size() << " sorted elements): " << duration.count() << " ms" << endl;
+    }
+
+    {
+        RBT<int> rbt;
+
+        auto start = high_resolution_clock::now();
+        rbt.build_from_sorted(valuesToInsert.begin(), valuesToInsert.end());
+        auto end = high_resolution_clock::now();
+        auto duration = duration_cast<milliseconds>(end - start);
+        cout << "RBT build_from_sorted duration (" << valuesToInsert.size() << " sorted elements): " << duration.count() << " ms" << endl;
+    }
+}
+
+void benchmarkAVLBatchInsert(const vector<int>& valuesToInsert) {
+    vector<int> treeKeys(valuesToInsert.size());
+    for (size_t i = 0; i < treeKeys.size(); ++i) {
+        treeKeys[i] = 2 * valuesToInsert[i];
+    }
+
+    mt19937 rng(valuesToInsert.size());
+    uniform_int_distribution<int> oddKeys(0, static_cast<int>(valuesToInsert.size()) - 1);
 
+    for (double ratio : {0.001, 0.01, 0.1, 1.0}) {
+        vector<int> batch(max<size_t>(1, valuesToInsert.size() * ratio));
+        for (int& key : batch) {
+            key = 2 * oddKeys(rng) + 1;
+        }
+        sort(batch.begin(), batch.end());
+
+        {
+            AVL<int> avl(treeKeys.begin(), treeKeys.end());
+
+            auto start = high_resolution_clock::now();
+            for (int key : batch) {
+                avl.insert(key);
+            }
+            auto end = high_resolution_clock::now();
+            auto duration = duration_cast<microseconds>(end - start);
+            cout << "AVL per-key insert duration (" << batch.size() << " keys into " << treeKeys.size() << "): " << duration.count() << " us" << endl;
+        }
+
+        {
+            AVL<int> avl(treeKeys.begin(), treeKeys.end());
+
+            auto start = high_resolution_clock::now();
+            avl.insert_batch(batch);
+            auto end = high_resolution_clock::now();
+            auto duration = duration_cast<microseconds>(end - start);
+            cout << "AVL insert_batch duration (" << batch.size() << " keys into " << treeKeys.size() << "): " << duration.count() << " us" << endl;
+        }
+    }
+}
+
+void benchmarkAVLSetOperations(const vector<int>& valuesToInsert) {
+    vector<int> evens(valuesToInsert.size());
+    vector<int> multiplesOfThree(valuesToInsert.size());
+    for (size_t i = 0; i < valuesToInsert.size(); ++i) {
+        evens[i] = 2 * valuesToInsert[i];
+        multiplesOfThree[i] = 3 * valuesToInsert[i];
+    }
+
+    for (unsigned threads : {1u, 2u, 4u, 8u, 16u}) {
+        ThreadPool pool(threads);
+        for (string operation : {"union_with", "intersect_with", "difference_with"}) {
+            AVL<int> a(evens.begin(), evens.end());
+            AVL<int> b(multiplesOfThree.begin(), multiplesOfThree.end());
+
+            auto start = high_resolution_clock::now();
+            if (operation == "union_with") {
+                a.union_with(std::move(b), &pool);
+            } else if (operation == "intersect_with") {
+                a.intersect_with(std::move(b), &pool);
+            } else {
+                a.difference_with(std::move(b), &pool);
+            }
+            auto end = high_resolution_clock::now();
+            auto duration = duration_cast<milliseconds>(end - start);
+            cout << "AVL " << operation << " duration (" << evens.size() << " + " << multiplesOfThree.size() << " elements, " << threads << " threads): " << duration.count() << " ms" << endl;
+        }
+    }
+}
+
+void benchmarkRBTSplitJoin(const vector<int>& valuesToInsert) {
+    int pivot = static_cast<int>(valuesToInsert.size() / 2);
+
+    {
+        RBT<int> rbt(valuesToInsert.begin(), valuesToInsert.end());
+
+        auto start = high_resolution_clock::now();
+        auto halves = rbt.split(pivot);
+        auto end = high_resolution_clock::now();
+        auto duration = duration_cast<microseconds>(end - start);
+        cout << "RBT split duration (" << valuesToInsert.size() << " elements): " << duration.count() << " us" << endl;
+
+        halves.second.remove(pivot);
+
+        start = high_resolution_clock::now();
+        RBT<int> joined = RBT<int>::join(std::move(halves.first), pivot, std::move(halves.second));
+        end = high_resolution_clock::now();
+        duration = duration_cast<microseconds>(end - start);
+        cout << "RBT join duration (" << valuesToInsert.size() << " elements): " << duration.count() << " us" << endl;
+    }
+
+    {
+        RBT<int> rbt(valuesToInsert.begin(), valuesToInsert.end());
+
+        auto start = high_resolution_clock::now();
+        RBT<int> lower;
+        RBT<int> upper;
+        for (int value : valuesToInsert) {
+            if (value < pivot) {
+                lower.insert(value);
+            } else {
+                upper.insert(value);
+            }
+        }
+        rbt.clear();
+        auto end = high_resolution_clock::now();
+        auto duration = duration_cast<microseconds>(end - start);
+        cout << "RBT split by reinsertion duration (" << valuesToInsert.size() << " elements): " << duration.count() << " us" << endl;
+
+        start = high_resolution_clock::now();
+        for (int value : valuesToInsert) {
+            if (value < pivot) {
+                rbt.insert(value);
+            }
+        }
+        for (int value : valuesToInsert) {
+            if (value >= pivot) {
+                rbt.insert(value);
+            }
+        }
+        lower.clear();
+        upper.clear();
+        end = high_resolution_clock::now();
+        duration = duration_cast<microseconds>(end - start);
+        cout << "RBT join by reinsertion duration (" << valuesToInsert.size() << " elements): " << duration.count() << " us" << endl;
+    }
+}
+
+void benchmarkAVLRangeScans(const vector<int>& valuesToInsert) {
+    AVL<int> avl;
+    for (int value : valuesToInsert) {
+        avl.insert(value);
+    }
+
+    mt19937 rng(valuesToInsert.size());
+    const int scans = 100;
+
+    for (size_t length : {1000, 10000, 100000}) {
+        if (length > valuesToInsert.size()) {
+            break;
+        }
+        uniform_int_distribution<int> starts(0, static_cast<int>(valuesToInsert.size() - length));
+        vector<int> lows(scans);
+        for (int& low : lows) {
+            low = starts(rng);
+        }
 
+        long long sum = 0;
+        auto start = high_resolution_clock::now();
+        for (int low : lows) {
+            auto it = avl.lower_bound(low);
+            for (size_t i = 0; i < length && it != avl.end(); ++i, ++it) {
+                sum += *it;
+            }
+        }
+        auto end = high_resolution_clock::now();
+        double nsPerKey = chrono::duration<double, nano>(end - start).count() / (scans * length);
+        cout << "AVL iterator range scan (" << length << " keys): " << nsPerKey << " ns/key (checksum " << sum << ")" << endl;
+
+        sum = 0;
+        start = high_resolution_clock::now();
+        for (int low : lows) {
+            auto it = lower_bound(valuesToInsert.begin(), valuesToInsert.end(), low);
+            for (size_t i = 0; i < length && it != valuesToInsert.end(); ++i, ++it) {
+                sum += *it;
+            }
+        }
+        end = high_resolution_clock::now();
+        nsPerKey = chrono::duration<double, nano>(end - start).count() / (scans * length);
+        cout << "Sorted vector range scan (" << length << " keys): " << nsPerKey << " ns/key (checksum " << sum << ")" << endl;
+    }
+}
+
+// Resident set size of this process, or 0 where it cannot be read.
+size_t residentBytes() {
+#ifdef __linux__
+    ifstream statm("/proc/self/statm");
+    size_t totalPages = 0;
+    size_t residentPages = 0;
+    statm >> totalPages >> residentPages;
+    return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+template<typename Tree>
+void benchmarkNodeLayout(const string& label, size_t nodeBytes, Tree& tree, const vector<int>& valuesToInsert, const vector<int>& probes) {
+    size_t before = residentBytes();
+    auto start = high_resolution_clock::now();
+    for (int value : valuesToInsert) {
+        tree.insert(value);
+    }
+    auto end = high_resolution_clock::now();
+    size_t after = residentBytes();
+    double insertMs = chrono::duration<double, milli>(end - start).count();
+
+    size_t found = 0;
     start = high_resolution_clock::now();
+    for (int probe : probes) {
+        if (tree.search(probe)) {
+            ++found;
+        }
+    }
+    end = high_resolution_clock::now();
+    double nsPerLookup = chrono::duration<double, nano>(end - start).count() / probes.size();
+
+    cout << label << ": " << nodeBytes << " byte nodes, "
+         << static_cast<double>(after - before) / valuesToInsert.size() << " resident bytes/key, "
+         << insertMs << " ms insert, "
+         << nsPerLookup << " ns/lookup (" << found << " found)" << endl;
+}
+
+vector<int> randomProbes(const vector<int>& valuesToInsert) {
+    mt19937 rng(valuesToInsert.size());
+    uniform_int_distribution<int> keys(0, static_cast<int>(valuesToInsert.size()) - 1);
+    vector<int> probes(valuesToInsert.size());
+    for (int& probe : probes) {
+        probe = keys(rng);
+    }
+    return probes;
+}
+
+void benchmarkRBTCompactNodes(const vector<int>& valuesToInsert) {
+    vector<int> probes = randomProbes(valuesToInsert);
+
+    // Both trees stay alive until the end so neither reuses memory the other freed.
+    RBT<int> rbt;
+    CompactRBT<int> compact;
+    benchmarkNodeLayout("RBT", sizeof(Node<int>), rbt, valuesToInsert, probes);
+    benchmarkNodeLayout("CompactRBT", CompactRBT<int>::nodeSize(), compact, valuesToInsert, probes);
+}
+
+template<typename Tree>
+void benchmarkAVLDeletes(const string& label, Tree& tree, const vector<int>& valuesToDelete) {
+    auto start = high_resolution_clock::now();
     for (int value : valuesToDelete) {
-        avl.deleteNode(value);
+        tree.deleteNode(value);
+    }
+    auto end = high_resolution_clock::now();
+    cout << label << " delete duration (" << valuesToDelete.size() << " elements): "
+         << chrono::duration<double, milli>(end - start).count() << " ms" << endl;
+}
+
+void benchmarkAVLCompactNodes(const vector<int>& valuesToInsert, const vector<int>& valuesToDelete) {
+    vector<int> probes = randomProbes(valuesToInsert);
+
+    AVL<int> avl;
+    CompactAVL<int> compact;
+    benchmarkNodeLayout("AVL", sizeof(NodeALV<int>), avl, valuesToInsert, probes);
+    benchmarkNodeLayout("CompactAVL", CompactAVL<int>::nodeSize(), compact, valuesToInsert, probes);
+    benchmarkAVLDeletes("AVL", avl, valuesToDelete);
+    benchmarkAVLDeletes("CompactAVL", compact, valuesToDelete);
+}
+
+void benchmarkAVLIndexedNodes(const vector<int>& valuesToInsert, const vector<int>& valuesToDelete) {
+    vector<int> probes = randomProbes(valuesToInsert);
+
+    AVL<int> avl;
+    IndexedAVL<int> indexed;
+    benchmarkNodeLayout("AVL", sizeof(NodeALV<int>), avl, valuesToInsert, probes);
+    benchmarkNodeLayout("IndexedAVL", IndexedAVL<int>::nodeSize(), indexed, valuesToInsert, probes);
+    benchmarkAVLDeletes("AVL", avl, valuesToDelete);
+    benchmarkAVLDeletes("IndexedAVL", indexed, valuesToDelete);
+}
+
+void benchmarkAVLFreeze(const vector<int>& valuesToInsert) {
+    vector<int> probes = randomProbes(valuesToInsert);
+    AVL<int> avl;
+    for (int value : valuesToInsert) {
+        avl.insert(value);
+    }
+
+    auto start = high_resolution_clock::now();
+    FrozenSet<int> frozen = avl.freeze();
+    auto end = high_resolution_clock::now();
+    cout << "AVL freeze duration (" << frozen.size() << " elements): "
+         << chrono::duration<double, milli>(end - start).count() << " ms" << endl;
+
+    size_t found = 0;
+    start = high_resolution_clock::now();
+    for (int probe : probes) {
+        if (avl.search(probe)) {
+            ++found;
+        }
     }
     end = high_resolution_clock::now();
-    duration = duration_cast<milliseconds>(end - start);
-    cout << "AVL delete duration (" << valuesToDelete.size() << " elements): " << duration.count() << " ms" << endl;
+    cout << "AVL search: " << chrono::duration<double, nano>(end - start).count() / probes.size()
+         << " ns/lookup (" << found << " found)" << endl;
+
+    found = 0;
+    start = high_resolution_clock::now();
+    for (int probe : probes) {
+        if (frozen.contains(probe)) {
+            ++found;
+        }
+    }
+    end = high_resolution_clock::now();
+    cout << "FrozenSet contains: " << chrono::duration<double, nano>(end - start).count() / probes.size()
+         << " ns/lookup (" << found << " found)" << endl;
+
+    unique_ptr<bool[]> results(new bool[probes.size()]);
+    start = high_resolution_clock::now();
+    frozen.contains(span<const int>(probes), span<bool>(results.get(), probes.size()));
+    end = high_resolution_clock::now();
+    found = count(results.get(), results.get() + probes.size(), true);
+    cout << "FrozenSet batch contains: " << chrono::duration<double, nano>(end - start).count() / probes.size()
+         << " ns/lookup (" << found << " found)" << endl;
 }
 
-void benchmarkRBT(const vector<int>& valuesToInsert, const vector<int>& valuesToDelete) {
+void benchmarkAVLSearchMany(const vector<int>& valuesToInsert) {
+    vector<int> probes = randomProbes(valuesToInsert);
+    AVL<int> avl;
+    for (int value : valuesToInsert) {
+        avl.insert(value);
+    }
+
+    size_t found = 0;
+    auto start = high_resolution_clock::now();
+    for (int probe : probes) {
+        found += avl.search(probe) != nullptr;
+    }
+    auto end = high_resolution_clock::now();
+    cout << "AVL search: " << chrono::duration<double, nano>(end - start).count() / probes.size()
+         << " ns/lookup (" << found << " found)" << endl;
+
+    vector<NodeALV<int>*> results(probes.size());
+    for (size_t group : {1, 4, 8, 16, 32, 64}) {
+        start = high_resolution_clock::now();
+        avl.search_many(probes, results, group);
+        end = high_resolution_clock::now();
+        found = results.size() - count(results.begin(), results.end(), nullptr);
+        cout << "AVL search_many (group " << group << "): " << chrono::duration<double, nano>(end - start).count() / probes.size()
+             << " ns/lookup (" << found << " found)" << endl;
+    }
+}
+
+// Random lookups against all three engines, and the B+-tree at each node size.
+// Every tree stays alive until the end so the resident-memory deltas are not
+// hidden by reuse of memory a previous tree freed.
+void benchmarkEngines(const vector<int>& valuesToInsert) {
+    vector<int> probes = randomProbes(valuesToInsert);
+    AVL<int> avl;
     RBT<int> rbt;
+    BTree<int, 64> btree64;
+    BTree<int, 128> btree128;
+    BTree<int, 256> btree256;
+    benchmarkNodeLayout("AVL", sizeof(NodeALV<int>), avl, valuesToInsert, probes);
+    benchmarkNodeLayout("RBT", sizeof(Node<int>), rbt, valuesToInsert, probes);
+    benchmarkNodeLayout("BTree<64>", BTree<int, 64>::nodeSize(), btree64, valuesToInsert, probes);
+    benchmarkNodeLayout("BTree<128>", BTree<int, 128>::nodeSize(), btree128, valuesToInsert, probes);
+    benchmarkNodeLayout("BTree<256>", BTree<int, 256>::nodeSize(), btree256, valuesToInsert, probes);
+}
 
+void benchmarkRBTHintedInsert(const vector<int>& valuesToInsert) {
+    {
+        RBT<int> rbt;
+        auto start = high_resolution_clock::now();
+        for (int value : valuesToInsert) {
+            rbt.insert(value);
+        }
+        auto end = high_resolution_clock::now();
+        cout << "RBT insert duration (" << valuesToInsert.size() << " ascending elements): "
+             << chrono::duration<double, milli>(end - start).count() << " ms" << endl;
+    }
+
+    {
+        RBT<int> rbt;
+        RBT<int>::TreeNode* hint = nullptr;
+        auto start = high_resolution_clock::now();
+        for (int value : valuesToInsert) {
+            hint = rbt.insert(hint, value);
+        }
+        auto end = high_resolution_clock::now();
+        cout << "RBT hinted insert duration (" << valuesToInsert.size() << " ascending elements): "
+             << chrono::duration<double, milli>(end - start).count() << " ms" << endl;
+    }
+}
+
+// One writer alternates random inserts and deletes while readers look up
+// random keys for 200 ms. Returns lookups and updates per second. Readers
+// watch the clock themselves, since a reader-preferring lock can keep the
+// writer from ever getting in.
+template<typename Read, typename Write>
+pair<double, double> measureReaderWriterThroughput(unsigned readers, int keyRange, const Read& read, const Write& write) {
+    atomic<size_t> totalReads(0);
+    vector<thread> threads;
+    auto start = high_resolution_clock::now();
+    auto deadline = start + milliseconds(200);
+    for (unsigned r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            mt19937 rng(r + 1);
+            uniform_int_distribution<int> keys(0, keyRange - 1);
+            size_t reads = 0;
+            size_t found = 0;
+            while (reads % 256 != 0 || high_resolution_clock::now() < deadline) {
+                found += read(keys(rng));
+                ++reads;
+            }
+            totalReads += reads + (found > reads);
+        });
+    }
+
+    mt19937 rng(0);
+    uniform_int_distribution<int> keys(0, keyRange - 1);
+    size_t writes = 0;
+    for (; high_resolution_clock::now() < deadline; ++writes) {
+        write(keys(rng), writes % 2 == 0);
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+    double seconds = chrono::duration<double>(high_resolution_clock::now() - start).count();
+    return {totalReads / seconds, writes / seconds};
+}
+
+void benchmarkPersistentAVL(const vector<int>& valuesToInsert) {
+    int keyRange = static_cast<int>(valuesToInsert.size());
+    for (unsigned readers : {1u, 2u, 4u, 8u}) {
+        PersistentAVL<int> persistent;
+        persistent.build_from_sorted(valuesToInsert.begin(), valuesToInsert.end());
+        auto [reads, writes] = measureReaderWriterThroughput(readers, keyRange,
+            [&](int key) { return persistent.search(key); },
+            [&](int key, bool add) { add ? persistent.insert(key) : persistent.deleteNode(key); });
+        cout << "PersistentAVL, 1 writer + " << readers << " readers: " << reads / 1e6 << " M lookups/s, "
+             << writes / 1e6 << " M updates/s" << endl;
+
+        AVL<int> avl;
+        avl.build_from_sorted(valuesToInsert.begin(), valuesToInsert.end());
+        shared_mutex lock;
+        tie(reads, writes) = measureReaderWriterThroughput(readers, keyRange,
+            [&](int key) { shared_lock<shared_mutex> guard(lock); return avl.search(key) != nullptr; },
+            [&](int key, bool add) { unique_lock<shared_mutex> guard(lock); add ? avl.insert(key) : avl.deleteNode(key); });
+        cout << "AVL + shared_mutex, 1 writer + " << readers << " readers: " << reads / 1e6 << " M lookups/s, "
+             << writes / 1e6 << " M updates/s" << endl;
+    }
+}
+
+// Every thread runs a mix of lookups and updatePercent% updates (half
+// inserts, half deletes) on random keys for 200 ms; returns the combined
+// operations per second.
+template<typename Search, typename Update>
+double measureMixedThroughput(unsigned threadCount, int keyRange, unsigned updatePercent, const Search& search, const Update& update) {
+    atomic<size_t> totalOps(0);
+    vector<thread> threads;
+    auto start = high_resolution_clock::now();
+    auto deadline = start + milliseconds(200);
+    for (unsigned t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&, t] {
+            mt19937 rng(t + 1);
+            uniform_int_distribution<int> keys(0, keyRange - 1);
+            size_t ops = 0;
+            size_t found = 0;
+            while (ops % 256 != 0 || high_resolution_clock::now() < deadline) {
+                unsigned roll = rng() % 100;
+                if (roll >= updatePercent) {
+                    found += search(keys(rng));
+                } else {
+                    update(keys(rng), roll % 2 == 0);
+                }
+                ++ops;
+            }
+            totalOps += ops + (found > ops);
+        });
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+    double seconds = chrono::duration<double>(high_resolution_clock::now() - start).count();
+    return totalOps / seconds;
+}
+
+// 1, 2, 4, ... threads, ending with one per available core.
+vector<unsigned> scalingThreadCounts() {
+    unsigned cores = max(1u, thread::hardware_concurrency());
+    vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < cores; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(cores);
+    return threadCounts;
+}
+
+void benchmarkConcurrentAVL(const vector<int>& valuesToInsert) {
+    int keyRange = static_cast<int>(valuesToInsert.size());
+    for (unsigned threads : scalingThreadCounts()) {
+        ConcurrentAVL<int> concurrent;
+        for (int value : valuesToInsert) {
+            concurrent.insert(value);
+        }
+        double ops = measureMixedThroughput(threads, keyRange, 10,
+            [&](int key) { return concurrent.search(key); },
+            [&](int key, bool add) { add ? concurrent.insert(key) : concurrent.deleteNode(key); });
+        cout << "ConcurrentAVL, " << threads << " threads, 90/10: " << ops / 1e6 << " M ops/s" << endl;
+
+        AVL<int> avl;
+        avl.build_from_sorted(valuesToInsert.begin(), valuesToInsert.end());
+        mutex lock;
+        ops = measureMixedThroughput(threads, keyRange, 10,
+            [&](int key) { lock_guard<mutex> guard(lock); return avl.search(key) != nullptr; },
+            [&](int key, bool add) { lock_guard<mutex> guard(lock); add ? avl.insert(key) : avl.deleteNode(key); });
+        cout << "AVL + mutex, " << threads << " threads, 90/10: " << ops / 1e6 << " M ops/s" << endl;
+    }
+}
+
+// Flat combining is aimed at contended writers, so besides the read-mostly
+// mix this runs one where half the operations are updates.
+void benchmarkFlatCombiningAVL(const vector<int>& valuesToInsert) {
+    int keyRange = static_cast<int>(valuesToInsert.size());
+    for (unsigned updatePercent : {50u, 10u}) {
+        for (unsigned threads : {2u, 4u, 8u, 16u, 32u, 64u}) {
+            FlatCombiningAVL<int> combining;
+            for (int value : valuesToInsert) {
+                combining.insert(value);
+            }
+            double ops = measureMixedThroughput(threads, keyRange, updatePercent,
+                [&](int key) { return combining.search(key); },
+                [&](int key, bool add) { add ? combining.insert(key) : combining.deleteNode(key); });
+            cout << "FlatCombiningAVL, " << threads << " threads, " << updatePercent << "% updates: " << ops / 1e6 << " M ops/s" << endl;
+
+            AVL<int> avl;
+            avl.build_from_sorted(valuesToInsert.begin(), valuesToInsert.end());
+            mutex lock;
+            ops = measureMixedThroughput(threads, keyRange, updatePercent,
+                [&](int key) { lock_guard<mutex> guard(lock); return avl.search(key) != nullptr; },
+                [&](int key, bool add) { lock_guard<mutex> guard(lock); add ? avl.insert(key) : avl.deleteNode(key); });
+            cout << "AVL + mutex, " << threads << " threads, " << updatePercent << "% updates: " << ops / 1e6 << " M ops/s" << endl;
+        }
+    }
+}
+
+void benchmarkLockFreeSkipList(const vector<int>& valuesToInsert) {
+    int keyRange = static_cast<int>(valuesToInsert.size());
+    for (unsigned updatePercent : {50u, 10u}) {
+        for (unsigned threads : {1u, 2u, 4u, 8u, 16u, 32u, 64u}) {
+            LockFreeSkipList<int> skipList;
+            for (int value : valuesToInsert) {
+                skipList.insert(value);
+            }
+            double ops = measureMixedThroughput(threads, keyRange, updatePercent,
+                [&](int key) { return skipList.search(key); },
+                [&](int key, bool add) { add ? skipList.insert(key) : skipList.remove(key); });
+            cout << "LockFreeSkipList, " << threads << " threads, " << updatePercent << "% updates: " << ops / 1e6 << " M ops/s" << endl;
+
+            ConcurrentAVL<int> concurrent;
+            for (int value : valuesToInsert) {
+                concurrent.insert(value);
+            }
+            ops = measureMixedThroughput(threads, keyRange, updatePercent,
+                [&](int key) { return concurrent.search(key); },
+                [&](int key, bool add) { add ? concurrent.insert(key) : concurrent.deleteNode(key); });
+            cout << "ConcurrentAVL, " << threads << " threads, " << updatePercent << "% updates: " << ops / 1e6 << " M ops/s" << endl;
+
+            AVL<int> avl;
+            avl.build_from_sorted(valuesToInsert.begin(), valuesToInsert.end());
+            mutex lock;
+            ops = measureMixedThroughput(threads, keyRange, updatePercent,
+                [&](int key) { lock_guard<mutex> guard(lock); return avl.search(key) != nullptr; },
+                [&](int key, bool add) { lock_guard<mutex> guard(lock); add ? avl.insert(key) : avl.deleteNode(key); });
+            cout << "AVL + mutex, " << threads << " threads, " << updatePercent << "% updates: " << ops / 1e6 << " M ops/s" << endl;
+        }
+    }
+}
+
+// Zipfian ranks in [0, n) with skew theta, rank 0 the most frequent, using
+// the method of Gray et al., "Quickly Generating Billion-Record Synthetic
+// Databases" (as in YCSB).
+class ZipfGenerator {
+public:
+    ZipfGenerator(uint64_t n, double theta = 0.99) : n(n), theta(theta) {
+        double zeta2 = 1.0 + pow(0.5, theta);
+        zetan = 0;
+        for (uint64_t i = 1; i <= n; ++i) {
+            zetan += 1.0 / pow(double(i), theta);
+        }
+        alpha = 1.0 / (1.0 - theta);
+        eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+    }
+
+    template<typename Rng>
+    uint64_t operator()(Rng& rng) {
+        double u = uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double uz = u * zetan;
+        if (uz < 1.0) {
+            return 0;
+        }
+        if (uz < 1.0 + pow(0.5, theta)) {
+            return 1;
+        }
+        return min<uint64_t>(n - 1, uint64_t(n * pow(eta * u - eta + 1.0, alpha)));
+    }
+
+private:
+    uint64_t n;
+    double theta;
+    double zetan;
+    double alpha;
+    double eta;
+};
+
+// Runs work(t) for t in [0, threadCount) on that many threads and returns
+// the wall-clock seconds until all of them finish.
+template<typename Work>
+double timeThreads(unsigned threadCount, const Work& work) {
+    vector<thread> threads;
+    auto start = high_resolution_clock::now();
+    for (unsigned t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&work, t] { work(t); });
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+    return chrono::duration<double>(high_resolution_clock::now() - start).count();
+}
+
+// Parallel ingest of one key per element, each thread inserting its own
+// slice. Keys are uniform over the int range, or zipfian with the hot keys
+// packed at the bottom of the key space, so range shards see the skew.
+void benchmarkShardedRBT(const vector<int>& valuesToInsert) {
+    size_t count = valuesToInsert.size();
+    mt19937_64 rng(count);
+    vector<int> uniformKeys(count);
+    uniform_int_distribution<int> anyInt(0, INT32_MAX);
+    for (int& key : uniformKeys) {
+        key = anyInt(rng);
+    }
+    vector<int> zipfKeys(count);
+    ZipfGenerator zipf(count);
+    for (int& key : zipfKeys) {
+        key = static_cast<int>(zipf(rng));
+    }
+
+    for (auto [label, keys] : {pair<const char*, const vector<int>*>{"uniform", &uniformKeys}, {"zipfian", &zipfKeys}}) {
+        for (unsigned threads : scalingThreadCounts()) {
+            auto slice = [&, threads](unsigned t) {
+                return span<const int>(*keys).subspan(count * t / threads, count * (t + 1) / threads - count * t / threads);
+            };
+
+            ShardedRBT<int> sharded;
+            double seconds = timeThreads(threads, [&](unsigned t) {
+                for (int key : slice(t)) {
+                    sharded.insert(key);
+                }
+            });
+            cout << "ShardedRBT, " << label << ", " << threads << " threads: " << count / seconds / 1e6 << " M inserts/s ("
+                 << sharded.size() << " keys, " << sharded.shardCount() << " shards)" << endl;
+
+            RBT<int> rbt;
+            mutex lock;
+            seconds = timeThreads(threads, [&](unsigned t) {
+                for (int key : slice(t)) {
+                    lock_guard<mutex> guard(lock);
+                    if (!rbt.search(key)) {
+                        rbt.insert(key);
+                    }
+                }
+            });
+            cout << "RBT + mutex, " << label << ", " << threads << " threads: " << count / seconds / 1e6 << " M inserts/s" << endl;
+        }
+    }
+}
+
+// Set operations the workload drivers need, over each engine's own API. RBT
+// keeps duplicates, so it inserts through insert_unique. BTree has no
+// range scan and only runs the key distributions.
+bool treeContains(const AVL<int>& tree, int key) {
+    return tree.search(key) != nullptr;
+}
+
+bool treeContains(const RBT<int>& tree, int key) {
+    return tree.search(key);
+}
+
+bool treeContains(const BTree<int>& tree, int key) {
+    return tree.search(key);
+}
+
+void treeInsert(AVL<int>& tree, int key) {
+    tree.insert(key);
+}
+
+void treeInsert(RBT<int>& tree, int key) {
+    tree.insert_unique(key);
+}
+
+void treeInsert(BTree<int>& tree, int key) {
+    tree.insert(key);
+}
+
+void treeErase(AVL<int>& tree, int key) {
+    tree.deleteNode(key);
+}
+
+void treeErase(RBT<int>& tree, int key) {
+    tree.remove(key);
+}
+
+void treeErase(BTree<int>& tree, int key) {
+    tree.remove(key);
+}
+
+// Both return how many keys lie in [lo, hi].
+size_t treeScan(const AVL<int>& tree, int lo, int hi) {
+    size_t visited = 0;
+    for (auto it = tree.lower_bound(lo); it != tree.end() && *it <= hi; ++it) {
+        ++visited;
+    }
+    return visited;
+}
+
+size_t treeScan(const RBT<int>& tree, int lo, int hi) {
+    size_t visited = 0;
+    tree.forEachInRange(lo, hi, [&](int) { ++visited; });
+    return visited;
+}
+
+const vector<string> KEY_DISTRIBUTIONS = {"sorted", "reverse", "uniform", "zipfian", "clustered"};
+
+// Keys in runs of consecutive values, for the "clustered" distribution.
+const size_t CLUSTER_LENGTH = 64;
+
+// A seeded sequence of count keys. All keys are even, so key + 1 is a
+// guaranteed miss that lands where a hit would. Zipfian ranks are scattered
+// over the key space with a multiplicative hash, as YCSB's scrambled zipfian
+// does, so the hot keys are not all neighbours in the tree.
+vector<int> generateKeys(const string& distribution, size_t count, uint64_t seed) {
+    mt19937_64 rng(seed);
+    uniform_int_distribution<int> anyKey(0, INT32_MAX / 2 - CLUSTER_LENGTH);
+    vector<int> keys(count);
+    if (distribution == "sorted") {
+        for (size_t i = 0; i < count; ++i) {
+            keys[i] = static_cast<int>(2 * i);
+        }
+    } else if (distribution == "reverse") {
+        for (size_t i = 0; i < count; ++i) {
+            keys[i] = static_cast<int>(2 * (count - 1 - i));
+        }
+    } else if (distribution == "uniform") {
+        for (int& key : keys) {
+            key = 2 * anyKey(rng);
+        }
+    } else if (distribution == "zipfian") {
+        ZipfGenerator zipf(count);
+        for (int& key : keys) {
+            key = static_cast<int>(((zipf(rng) + 1) * 0x9E3779B97F4A7C15ULL) >> 34) & ~1;
+        }
+    } else if (distribution == "clustered") {
+        for (size_t i = 0; i < count; i += CLUSTER_LENGTH) {
+            int base = 2 * anyKey(rng);
+            for (size_t j = i; j < min(count, i + CLUSTER_LENGTH); ++j) {
+                keys[j] = base + static_cast<int>(2 * (j - i));
+            }
+        }
+    }
+    return keys;
+}
+
+// An empty phase, such as the deletes of a one or two key run, counts as 0.
+template<typename Op>
+double nanosPerKey(const vector<int>& keys, const Op& op) {
+    if (keys.empty()) {
+        return 0;
+    }
+    auto start = high_resolution_clock::now();
+    for (int key : keys) {
+        op(key);
+    }
+    auto end = high_resolution_clock::now();
+    return chrono::duration<double, nano>(end - start).count() / keys.size();
+}
+
+void printSummary(const string& label, const Summary& summary) {
+    cout << label << ": median " << summary.median << " ns/op, p95 " << summary.p95 << " ns/op, 95% CI ["
+         << summary.ciLow << ", " << summary.ciHigh << "] (" << summary.runs << " runs)" << endl;
+}
+
+// Inserts keys in the order given, looks up every key in a shuffled order
+// and again one past each (all misses), then deletes the first third of the
+// insertion sequence. Every run starts from an empty tree; the warm-up runs
+// are not recorded.
+template<typename Tree>
+void benchmarkKeyDistribution(BenchmarkRecorder& recorder, const string& label, const string& distribution, const vector<int>& keys) {
+    vector<int> probes = keys;
+    shuffle(probes.begin(), probes.end(), mt19937(keys.size()));
+    vector<int> misses = probes;
+    for (int& miss : misses) {
+        ++miss;
+    }
+    vector<int> deletes(keys.begin(), keys.begin() + keys.size() / 3);
+
+    const char* phases[] = {"insert", "lookup", "negative lookup", "delete"};
+    vector<double> samples[4];
+    for (int run = 0; run < recorder.warmupRuns() + recorder.measuredRuns(); ++run) {
+        Tree tree;
+        double nanos[4];
+        nanos[0] = nanosPerKey(keys, [&](int key) { treeInsert(tree, key); });
+        nanos[1] = nanosPerKey(probes, [&](int key) { doNotOptimize(treeContains(tree, key)); });
+        nanos[2] = nanosPerKey(misses, [&](int key) { doNotOptimize(treeContains(tree, key)); });
+        nanos[3] = nanosPerKey(deletes, [&](int key) { treeErase(tree, key); });
+        if (run >= recorder.warmupRuns()) {
+            for (int phase = 0; phase < 4; ++phase) {
+                samples[phase].push_back(nanos[phase]);
+            }
+        }
+    }
+    for (int phase = 0; phase < 4; ++phase) {
+        const Summary& summary = recorder.record(label, distribution, phases[phase], keys.size(), samples[phase]);
+        printSummary(label + ", " + distribution + " keys, " + phases[phase], summary);
+    }
+}
+
+// YCSB core workloads (Cooper et al., "Benchmarking Cloud Serving Systems
+// with YCSB", SoCC 2010), in percent of operations.
+struct YcsbMix {
+    const char* name;
+    unsigned read;
+    unsigned update;
+    unsigned insert;
+    unsigned scan;
+    unsigned readModifyWrite;
+    // Reads favour the most recent inserts instead of zipfian-hot records.
+    bool latest;
+};
+
+const vector<YcsbMix> YCSB_MIXES = {
+    {"A", 50, 50, 0, 0, 0, false},
+    {"B", 95, 5, 0, 0, 0, false},
+    {"C", 100, 0, 0, 0, 0, false},
+    {"F", 50, 0, 0, 0, 50, false},
+    {"D", 95, 0, 5, 0, 0, true},
+    {"E", 0, 0, 5, 95, 0, false},
+};
+
+const unsigned YCSB_MAX_SCAN = 100;
+
+// Every run of every mix loads the same count records into a fresh tree, so
+// the inserts of D and E, or of earlier runs, never carry over and the key
+// set depends on count alone. The set has no values, so an update deletes
+// and reinserts its key, and a read-modify-write is a lookup followed by an
+// update. A scan covers a key range holding about 1..YCSB_MAX_SCAN records.
+// Each run gets fresh operations, generated before the clock starts.
+template<typename Tree>
+void benchmarkYcsb(BenchmarkRecorder& recorder, const string& label, size_t count) {
+    if (count == 0) {
+        throw invalid_argument("benchmarkYcsb: count must be positive");
+    }
+    int runs = recorder.warmupRuns() + recorder.measuredRuns();
+    size_t operations = min<size_t>(count, 1000000);
+
+    // Even keys in random order: the first count are loaded, the rest are
+    // what inserts add, enough for every operation of a run to be one.
+    vector<int> records(count + operations);
+    for (size_t i = 0; i < records.size(); ++i) {
+        records[i] = static_cast<int>(2 * i);
+    }
+    mt19937_64 rng(count);
+    shuffle(records.begin(), records.end(), rng);
+    // Distance between neighbouring loaded keys, on average.
+    int spacing = static_cast<int>(2 * records.size() / count);
+
+    ZipfGenerator zipf(count);
+    uniform_int_distribution<unsigned> percent(0, 99);
+    uniform_int_distribution<unsigned> scanLength(1, YCSB_MAX_SCAN);
+
+    enum Kind { READ, UPDATE, INSERT, SCAN, READ_MODIFY_WRITE };
+    struct Operation {
+        Kind kind;
+        int key;
+        // Upper end of a scan's key range.
+        int high;
+    };
+    vector<Operation> ops(operations);
+
+    for (const YcsbMix& mix : YCSB_MIXES) {
+        vector<double> samples;
+        for (int run = 0; run < runs; ++run) {
+            Tree tree;
+            for (size_t i = 0; i < count; ++i) {
+                treeInsert(tree, records[i]);
+            }
+            size_t inserted = count;
+            for (Operation& op : ops) {
+                unsigned roll = percent(rng);
+                if (roll < mix.insert) {
+                    op = {INSERT, records[inserted++], 0};
+                    continue;
+                }
+                size_t rank = min<size_t>(zipf(rng), inserted - 1);
+                int key = records[mix.latest ? inserted - 1 - rank : rank];
+                roll -= mix.insert;
+                if (roll < mix.read) {
+                    op = {READ, key, 0};
+                } else if ((roll -= mix.read) < mix.update) {
+                    op = {UPDATE, key, 0};
+                } else if ((roll -= mix.update) < mix.scan) {
+                    op = {SCAN, key, key + spacing * static_cast<int>(scanLength(rng))};
+                } else {
+                    op = {READ_MODIFY_WRITE, key, 0};
+                }
+            }
+
+            auto start = high_resolution_clock::now();
+            for (const Operation& op : ops) {
+                switch (op.kind) {
+                case READ:
+                    doNotOptimize(treeContains(tree, op.key));
+                    break;
+                case UPDATE:
+                    treeErase(tree, op.key);
+                    treeInsert(tree, op.key);
+                    break;
+                case INSERT:
+                    treeInsert(tree, op.key);
+                    break;
+                case SCAN:
+                    doNotOptimize(treeScan(tree, op.key, op.high));
+                    break;
+                case READ_MODIFY_WRITE:
+                    doNotOptimize(treeContains(tree, op.key));
+                    treeErase(tree, op.key);
+                    treeInsert(tree, op.key);
+                    break;
+                }
+            }
+            auto end = high_resolution_clock::now();
+            if (run >= recorder.warmupRuns()) {
+                samples.push_back(chrono::duration<double, nano>(end - start).count() / operations);
+            }
+        }
+        const Summary& summary = recorder.record(label, "ycsb", mix.name, count, samples);
+        printSummary(label + ", YCSB " + mix.name, summary);
+    }
+}
+
+void benchmarkRBTResource(const string& label, unique_ptr<pmr::memory_resource> owned, const vector<int>& valuesToInsert, const vector<int>& valuesToDelete) {
+    pmr::memory_resource* resource = owned ? owned.get() : pmr::new_delete_resource();
+    auto* rbt = new RBT<int>(resource);
 
     auto start = high_resolution_clock::now();
     for (int value : valuesToInsert) {
-        rbt.insert(value);
+        rbt->insert(value);
     }
     auto end = high_resolution_clock::now();
     auto duration = duration_cast<milliseconds>(end - start);
-    cout << "RBT insert duration (" << valuesToInsert.size() << " elements): " << duration.count() << " ms" << endl;
+    cout << "RBT (" << label << ") insert duration (" << valuesToInsert.size() << " elements): " << duration.count() << " ms" << endl;
 
 
     start = high_resolution_clock::now();
-    for (int value : valuesToInsert) {
-        rbt.search(value);
+    for (int value : valuesToDelete) {
+        rbt->remove(value);
     }
     end = high_resolution_clock::now();
     duration = duration_cast<milliseconds>(end - start);
-    cout << "RBT search duration (" << valuesToInsert.size() << " elements): " << duration.count() << " ms" << endl;
+    cout << "RBT (" << label << ") delete duration (" << valuesToDelete.size() << " elements): " << duration.count() << " ms" << endl;
 
-   start = high_resolution_clock::now();
-    for (int value : valuesToDelete) {
-        rbt.remove(value);
-    }
+
+    start = high_resolution_clock::now();
+    delete rbt;
+    owned.reset();
     end = high_resolution_clock::now();
     duration = duration_cast<milliseconds>(end - start);
-    cout << "RBT delete duration (" << valuesToDelete.size() << " elements): " << duration.count() << " ms" << endl;
+    cout << "RBT (" << label << ") teardown duration (" << valuesToInsert.size() - valuesToDelete.size() << " elements): " << duration.count() << " ms" << endl;
 }
 
-int main() {
+void benchmarkRBTResources(const vector<int>& valuesToInsert, const vector<int>& valuesToDelete) {
+    benchmarkRBTResource("new/delete", nullptr, valuesToInsert, valuesToDelete);
+    benchmarkRBTResource("monotonic buffer", make_unique<pmr::monotonic_buffer_resource>(valuesToInsert.size() * sizeof(Node<int>)), valuesToInsert, valuesToDelete);
+    benchmarkRBTResource("unsynchronized pool", make_unique<pmr::unsynchronized_pool_resource>(), valuesToInsert, valuesToDelete);
+}
+
+void benchmarkLookups(const vector<int>& valuesToInsert) {
+    vector<int> probes = randomProbes(valuesToInsert);
+
+    {
+        AVL<int> avl;
+        for (int value : valuesToInsert) {
+            avl.insert(value);
+        }
+
+        size_t found = 0;
+        auto start = high_resolution_clock::now();
+        for (int probe : probes) {
+            found += avl.search(probe) != nullptr;
+        }
+        auto end = high_resolution_clock::now();
+        double nsPerLookup = chrono::duration<double, nano>(end - start).count() / probes.size();
+        cout << "AVL search: " << nsPerLookup << " ns/lookup (" << probes.size() << " random probes, " << found << " found)" << endl;
+    }
+
+    {
+        RBT<int> rbt;
+        for (int value : valuesToInsert) {
+            rbt.insert(value);
+        }
+
+        size_t found = 0;
+        auto start = high_resolution_clock::now();
+        for (int probe : probes) {
+            found += rbt.search(probe);
+        }
+        auto end = high_resolution_clock::now();
+        double nsPerLookup = chrono::duration<double, nano>(end - start).count() / probes.size();
+        cout << "RBT search: " << nsPerLookup << " ns/lookup (" << probes.size() << " random probes, " << found << " found)" << endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
     srand(time(0));
 
-    for (int size : SIZES) {
+    // Options may go anywhere; the remaining arguments are the mode and the size.
+    int warmupRuns = 1;
+    int measuredRuns = 6;
+    string jsonPath;
+    string csvPath;
+    vector<string> positional;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--warmup=", 0) == 0) {
+            warmupRuns = max(0, atoi(arg.c_str() + 9));
+        } else if (arg.rfind("--runs=", 0) == 0) {
+            measuredRuns = max(1, atoi(arg.c_str() + 7));
+        } else if (arg.rfind("--json=", 0) == 0) {
+            jsonPath = arg.substr(7);
+        } else if (arg.rfind("--csv=", 0) == 0) {
+            csvPath = arg.substr(6);
+        } else if (arg.rfind("--", 0) == 0) {
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
+    // No mode, or "suite", runs the workload suite, the only one that fills
+    // --json and --csv.
+    string mode = positional.size() > 0 ? positional[0] : "";
+    if (!mode.empty() && mode != "suite" && mode != "pmr" && mode != "iterative" && mode != "search" && mode != "bulk" && mode != "batch" && mode != "setops" && mode != "splitjoin" && mode != "range" && mode != "compact" && mode != "indexed" && mode != "freeze" && mode != "engines" && mode != "searchmany" && mode != "hint" && mode != "persistent" && mode != "concurrent" && mode != "sharded" && mode != "combining" && mode != "skiplist") {
+        cerr << "Unknown benchmark mode: " << mode << endl;
+        return 1;
+    }
+
+    // An optional second argument replaces the default sizes, e.g. "AVL indexed 100000000".
+    vector<int> sizes = SIZES;
+    if (positional.size() > 1) {
+        const char* text = positional[1].c_str();
+        char* end = nullptr;
+        errno = 0;
+        long size = strtol(text, &end, 10);
+        if (end == text || *end != '\0' || errno == ERANGE || size <= 0 || size > INT_MAX) {
+            cerr << "Invalid size: " << positional[1] << " (expected a positive integer)" << endl;
+            return 1;
+        }
+        sizes = {static_cast<int>(size)};
+    }
+
+    BenchmarkRecorder recorder(warmupRuns, measuredRuns);
+    for (int size : sizes) {
         vector<int> valuesToInsert;
         vector<int> valuesToDelete;
 
@@ -92,15 +1229,106 @@ int main() {
         cout << "Benchmarking with " << size << " elements..." << endl;
         cout << "--------------------------------------" << endl;
 
-        cout << "Benchmarking AVL Tree..." << endl;
-        benchmarkAVL(valuesToInsert, valuesToDelete);
+        if (mode == "pmr") {
+            cout << "Benchmarking Red-Black Tree memory resources..." << endl;
+            benchmarkRBTResources(valuesToInsert, valuesToDelete);
+        } else if (mode == "iterative") {
+            cout << "Benchmarking AVL recursive vs iterative retracing..." << endl;
+            benchmarkAVLRetracing("sequential", valuesToInsert, valuesToDelete);
+
+            mt19937 rng(size);
+            vector<int> shuffledInsert = valuesToInsert;
+            shuffle(shuffledInsert.begin(), shuffledInsert.end(), rng);
+            vector<int> shuffledDelete(shuffledInsert.begin(), shuffledInsert.begin() + valuesToDelete.size());
+            shuffle(shuffledDelete.begin(), shuffledDelete.end(), rng);
+            benchmarkAVLRetracing("random", shuffledInsert, shuffledDelete);
+        } else if (mode == "search") {
+            cout << "Benchmarking random lookups..." << endl;
+            benchmarkLookups(valuesToInsert);
+        } else if (mode == "bulk") {
+            cout << "Benchmarking bulk construction from sorted keys..." << endl;
+            benchmarkAVLBulkLoad(valuesToInsert);
+            benchmarkRBTBulkLoad(valuesToInsert);
+        } else if (mode == "batch") {
+            cout << "Benchmarking AVL sorted batch insert..." << endl;
+            benchmarkAVLBatchInsert(valuesToInsert);
+        } else if (mode == "setops") {
+            cout << "Benchmarking AVL set operations..." << endl;
+            benchmarkAVLSetOperations(valuesToInsert);
+        } else if (mode == "splitjoin") {
+            cout << "Benchmarking RBT split and join..." << endl;
+            benchmarkRBTSplitJoin(valuesToInsert);
+        } else if (mode == "range") {
+            cout << "Benchmarking AVL range scans..." << endl;
+            benchmarkAVLRangeScans(valuesToInsert);
+        } else if (mode == "compact") {
+            cout << "Benchmarking compact AVL nodes..." << endl;
+            benchmarkAVLCompactNodes(valuesToInsert, valuesToDelete);
+            cout << "Benchmarking compact red-black tree nodes..." << endl;
+            benchmarkRBTCompactNodes(valuesToInsert);
+        } else if (mode == "indexed") {
+            cout << "Benchmarking index-addressed AVL nodes..." << endl;
+            benchmarkAVLIndexedNodes(valuesToInsert, valuesToDelete);
+        } else if (mode == "freeze") {
+            cout << "Benchmarking frozen AVL snapshots..." << endl;
+            benchmarkAVLFreeze(valuesToInsert);
+        } else if (mode == "engines") {
+            cout << "Benchmarking AVL, RBT and BTree lookups..." << endl;
+            benchmarkEngines(valuesToInsert);
+        } else if (mode == "searchmany") {
+            cout << "Benchmarking interleaved AVL lookups..." << endl;
+            benchmarkAVLSearchMany(valuesToInsert);
+        } else if (mode == "hint") {
+            cout << "Benchmarking hinted RBT inserts..." << endl;
+            benchmarkRBTHintedInsert(valuesToInsert);
+        } else if (mode == "persistent") {
+            cout << "Benchmarking persistent AVL readers..." << endl;
+            benchmarkPersistentAVL(valuesToInsert);
+        } else if (mode == "concurrent") {
+            cout << "Benchmarking concurrent AVL scaling..." << endl;
+            benchmarkConcurrentAVL(valuesToInsert);
+        } else if (mode == "sharded") {
+            cout << "Benchmarking sharded RBT ingest..." << endl;
+            benchmarkShardedRBT(valuesToInsert);
+        } else if (mode == "combining") {
+            cout << "Benchmarking flat-combining AVL..." << endl;
+            benchmarkFlatCombiningAVL(valuesToInsert);
+        } else if (mode == "skiplist") {
+            cout << "Benchmarking lock-free skip list scaling..." << endl;
+            benchmarkLockFreeSkipList(valuesToInsert);
+        } else {
+            cout << "Benchmarking key distributions..." << endl;
+            for (const string& distribution : KEY_DISTRIBUTIONS) {
+                vector<int> keys = generateKeys(distribution, size, size);
+                benchmarkKeyDistribution<AVL<int>>(recorder, "AVL", distribution, keys);
+                benchmarkKeyDistribution<RBT<int>>(recorder, "RBT", distribution, keys);
+                benchmarkKeyDistribution<BTree<int>>(recorder, "BTree", distribution, keys);
+            }
 
-        cout << "Benchmarking Red-Black Tree..." << endl;
-        benchmarkRBT(valuesToInsert, valuesToDelete);
+            cout << "Benchmarking YCSB workloads..." << endl;
+            benchmarkYcsb<AVL<int>>(recorder, "AVL", size);
+            benchmarkYcsb<RBT<int>>(recorder, "RBT", size);
+
+            cout << "Benchmarking AVL node allocators..." << endl;
+            benchmarkAVLAllocator<HeapNodeAllocator<NodeALV<int>>>("new/delete", valuesToInsert);
+            benchmarkAVLAllocator<NodeArena<NodeALV<int>>>("slab arena", valuesToInsert);
+        }
 
         cout << "--------------------------------------" << endl;
         cout << endl;
     }
 
+    try {
+        if (!jsonPath.empty()) {
+            writeJson(jsonPath, recorder.results());
+        }
+        if (!csvPath.empty()) {
+            writeCsv(csvPath, recorder.results());
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
     return 0;
 }